@@ -8,14 +8,24 @@
 
 #include <PCA9557.h>
 
-PCA9557::PCA9557(I2C& i2c, DeviceAddress slaveAddr)
-    : i2c(i2c), slaveAddr(slaveAddr) {
+PCA9557::PCA9557(I2C& i2c, DeviceAddress slaveAddr, I2cBus* bus)
+    : shadowValid(0), busTransactions_(0), i2c(i2c), slaveAddr(slaveAddr), bus(bus) {
 
 }
 
 uint8_t PCA9557::readRegister8(MemoryAddress regAddr, bool& success) {
     success = false;
 
+    busTransactions_++;
+    if (bus != NULL) {  // keep all traffic on the shared queue
+        I2cTransaction transaction;
+        transaction.address = slaveAddr;
+        transaction.reg = regAddr;
+        transaction.read = true;
+        success = bus->transfer(transaction);
+        return success ? transaction.value : 0;
+    }
+
     uint8_t data[1] = { regAddr };
     int status = i2c.write(slaveAddr, (const char*)data, sizeof(data), true);
     if (status == 0) {
@@ -28,7 +38,101 @@ uint8_t PCA9557::readRegister8(MemoryAddress regAddr, bool& success) {
 }
 
 bool PCA9557::writeRegister8(MemoryAddress regAddr, uint8_t value) {
+    busTransactions_++;
+    if (bus != NULL) {  // keep all traffic on the shared queue
+        I2cTransaction transaction;
+        transaction.address = slaveAddr;
+        transaction.reg = regAddr;
+        transaction.read = false;
+        transaction.value = value;
+        return bus->transfer(transaction);
+    }
+
     uint8_t data[2] = { regAddr, value };
     int status = i2c.write(slaveAddr, (const char*)data, sizeof(data));
     return status == 0;
 }
+
+bool PCA9557::writeShadowed(MemoryAddress regAddr, uint8_t value) {
+    if ((shadowValid & (1 << regAddr)) && shadow[regAddr] == value) {
+        return true;
+    }
+
+    if (writeRegister8(regAddr, value)) {
+        shadow[regAddr] = value;
+        shadowValid |= (1 << regAddr);
+        return true;
+    } else {
+        // The write may or may not have taken effect
+        shadowValid &= ~(1 << regAddr);
+        return false;
+    }
+}
+
+bool PCA9557::writeMasked(uint8_t mask, uint8_t outputHighBits) {
+    uint8_t outputs;
+    if (!readOutputs(outputs)) {
+        return false;
+    }
+    shadow[OUTPUT] = outputs;
+    shadowValid |= (1 << OUTPUT);
+    return writeShadowed(OUTPUT, (outputs & ~mask) | (outputHighBits & mask));
+}
+
+bool PCA9557::togglePin(uint8_t pin) {
+    uint8_t outputs;
+    if (!readOutputs(outputs)) {
+        return false;
+    }
+    shadow[OUTPUT] = outputs;
+    shadowValid |= (1 << OUTPUT);
+    return writeShadowed(OUTPUT, outputs ^ (1 << pin));
+}
+
+bool PCA9557::sync() {
+    static const MemoryAddress kShadowed[] = { OUTPUT, POLARITY, CONFIG };
+    bool allSuccess = true;
+    for (size_t i = 0; i < sizeof(kShadowed) / sizeof(kShadowed[0]); i++) {
+        bool success = false;
+        uint8_t value = readRegister8(kShadowed[i], success);
+        if (success) {
+            shadow[kShadowed[i]] = value;
+            shadowValid |= (1 << kShadowed[i]);
+        } else {
+            shadowValid &= ~(1 << kShadowed[i]);
+            allSuccess = false;
+        }
+    }
+    return allSuccess;
+}
+
+bool PCA9557::writeOutputsAsync(I2cTransaction& transaction, uint8_t outputHighBits,
+                                Callback<void()> done) {
+    if (bus == NULL) {
+        return false;
+    }
+
+    shadowValid &= ~(1 << OUTPUT);
+    transaction.address = slaveAddr;
+    transaction.reg = OUTPUT;
+    transaction.read = false;
+    transaction.value = outputHighBits;
+    transaction.done = done;
+    busTransactions_++;
+    bus->submit(transaction);
+    return true;
+}
+
+bool PCA9557::readInputsAsync(I2cTransaction& transaction, Callback<void()> done) {
+    if (bus == NULL) {
+        return false;
+    }
+
+    transaction.address = slaveAddr;
+    transaction.reg = INPUT;
+    transaction.read = true;
+    transaction.done = done;
+    busTransactions_++;
+    bus->submit(transaction);
+    return true;
+}
@@ -13,6 +13,8 @@
 #include <mbed.h>
 #include <stdint.h>
 
+#include "I2cBus.h"
+
 class PCA9557 {
 public:
     typedef int DeviceAddress;
@@ -21,8 +23,11 @@ public:
      *
      *  @param i2c I2C master interface
      *  @param slaveAddr 7-bit I2C slave device address
+     *  @param bus optional shared bus for the asynchronous API, usually an
+     *             AsyncI2C wrapping the same peripheral as i2c. When given,
+     *             the blocking methods also queue their transfers on it.
      */
-    PCA9557(I2C& i2c, DeviceAddress slaveAddr);
+    PCA9557(I2C& i2c, DeviceAddress slaveAddr, I2cBus* bus = NULL);
 
     /** Set the input/output direction for the 8 IO pins
      *
@@ -51,6 +56,7 @@ public:
      *
      *  A high bit indicates that the IO pin is logic high, as dictated
      *  by the polarity.
+     *  Served from the shadow register without bus traffic when it is valid.
      *
      *  @param outputHighBits mask of IO pins that are logic high, returned
      *                            by reference
@@ -64,11 +70,52 @@ public:
      *
      *  A high bit indicates that the output is on
      *  The remaining IO pins are left unchanged
+     *  Skipped without bus traffic if the shadow register already has this value.
      *
      *  @param outputHighBits mask of output pins that are on
      */
     bool writeOutputs(uint8_t outputHighBits);
 
+    /** Set only the selected output bits, leaving the others unchanged
+     *
+     *  Reads the output register first only if its shadow is not valid,
+     *  and skips the write if nothing changes.
+     *
+     *  @param mask mask of output pins to change
+     *  @param outputHighBits new state of the pins in mask
+     */
+    bool writeMasked(uint8_t mask, uint8_t outputHighBits);
+
+    /** Turn on a single output pin (0-7), see writeMasked
+     */
+    bool setPin(uint8_t pin);
+
+    /** Turn off a single output pin (0-7), see writeMasked
+     */
+    bool clearPin(uint8_t pin);
+
+    /** Toggle a single output pin (0-7), see writeMasked
+     */
+    bool togglePin(uint8_t pin);
+
+    /** Reload the OUTPUT, POLARITY and CONFIG shadow registers from the device
+     *
+     *  @returns
+     *    true if all registers were read successfully, false otherwise
+     */
+    bool sync();
+
+    /** Discard the shadow registers, for example after the device may have
+     *  been reset, so the next writes always go to the bus
+     */
+    void invalidate();
+
+    /** Returns the number of I2C transactions issued, for measuring bus load
+     */
+    uint32_t busTransactions() const {
+        return busTransactions_;
+    }
+
     /** Read the logic level for the 8 IO pins
      *
      *  A high bit indicates that the IO pin is logic high, as dictated
@@ -82,6 +129,34 @@ public:
      */
     bool readInputs(uint8_t& inputLogicHighBits);
 
+    /** Queue a write of the output state on the shared bus, without waiting
+     *
+     *  Consecutive queued writes to the same expander are merged by the bus,
+     *  so only the latest state is sent. The output shadow register is
+     *  discarded, since the write may still fail.
+     *
+     *  @param transaction storage for the request, which must stay valid
+     *                     until done fires or transaction.status is no
+     *                     longer kPending
+     *  @param outputHighBits mask of output pins that are on
+     *  @param done called on completion, possibly from interrupt context
+     *
+     *  @returns
+     *    true if queued, false if no bus was given
+     */
+    bool writeOutputsAsync(I2cTransaction& transaction, uint8_t outputHighBits,
+                           Callback<void()> done = Callback<void()>());
+
+    /** Queue a read of the logic level for the 8 IO pins, without waiting
+     *
+     *  On completion with kOk, the input state is in transaction.value.
+     *
+     *  @returns
+     *    true if queued, false if no bus was given
+     */
+    bool readInputsAsync(I2cTransaction& transaction,
+                         Callback<void()> done = Callback<void()>());
+
 protected:
     enum MemoryAddress {
         INPUT = 0b00,
@@ -111,16 +186,35 @@ protected:
      */
     bool writeRegister8(MemoryAddress address, uint8_t value);
 
+    /** Write a register through its shadow copy, skipping the bus if unchanged
+     */
+    bool writeShadowed(MemoryAddress regAddr, uint8_t value);
+
+    // Shadow copies of the OUTPUT, POLARITY and CONFIG registers, indexed by address
+    uint8_t shadow[4];
+    uint8_t shadowValid;  // bit per register address
+    uint32_t busTransactions_;
+
 private:
     I2C& i2c;
     const DeviceAddress slaveAddr;
+    I2cBus* bus;
 };
 
 inline bool PCA9557::setDirection(uint8_t selectedInputBits) {
-    return writeRegister8(CONFIG, selectedInputBits);
+    return writeShadowed(CONFIG, selectedInputBits);
+}
+
+inline bool PCA9557::setInputPolarity(uint8_t invertedInputBits) {
+    return writeShadowed(POLARITY, invertedInputBits);
 }
 
 inline bool PCA9557::readOutputs(uint8_t& outputHighBits) {
+    if (shadowValid & (1 << OUTPUT)) {
+        outputHighBits = shadow[OUTPUT];
+        return true;
+    }
+
     bool success = false;
     outputHighBits = readRegister8(OUTPUT, success);
 
@@ -132,7 +226,19 @@ inline bool PCA9557::readOutputs(uint8_t& outputHighBits) {
 }
 
 inline bool PCA9557::writeOutputs(uint8_t outputHighBits) {
-    return writeRegister8(OUTPUT, outputHighBits);
+    return writeShadowed(OUTPUT, outputHighBits);
+}
+
+inline bool PCA9557::setPin(uint8_t pin) {
+    return writeMasked(1 << pin, 0xFF);
+}
+
+inline bool PCA9557::clearPin(uint8_t pin) {
+    return writeMasked(1 << pin, 0x00);
+}
+
+inline void PCA9557::invalidate() {
+    shadowValid = 0;
 }
 
 inline bool PCA9557::readInputs(uint8_t& inputLogicHighBits) {
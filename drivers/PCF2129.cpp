@@ -17,20 +17,56 @@ static uint8_t bcdToInt(uint8_t in) {
       + (in & 0xf);
 }
 
-bool PCF2129::gettime(tm *time) {
-    int command = 0b10100000;           //Read starting at the sec register
-    RTC_cs = 0;
-    wait_us(1);
-    /** Write in command, then read the registers holding the time componenets */
-    RTC_spi.write(command | 0x03);
-    uint8_t sec = RTC_spi.write(0x00);
-    uint8_t min = RTC_spi.write(0x00);
-    uint8_t hour = RTC_spi.write(0x00);
-    uint8_t day = RTC_spi.write(0x00);
-    uint8_t weekday = RTC_spi.write(0x00);
-    uint8_t month = RTC_spi.write(0x00);
-    uint8_t year = RTC_spi.write(0x00);
-    RTC_cs = 1;
+void PCF2129::checkRange(uint8_t reg, size_t len) {
+    if (reg + len > kNumRegisters) {
+        error("PCF2129 register access out of range");
+    }
+}
+
+void PCF2129::readRegisters(uint8_t reg, uint8_t* data, size_t len) {
+    checkRange(reg, len);
+    uint8_t tx[1 + kNumRegisters] = { (uint8_t)(0b10100000 | reg) };  // Read, auto-increment
+    uint8_t rx[1 + kNumRegisters];
+    SpiTransaction transaction;
+    transaction.cs = &RTC_cs;
+    transaction.tx = tx;
+    transaction.rx = rx;
+    transaction.length = 1 + len;
+    RTC_bus.transfer(transaction);
+    memcpy(data, rx + 1, len);
+}
+
+void PCF2129::writeRegisters(uint8_t reg, const uint8_t* data, size_t len) {
+    checkRange(reg, len);
+    uint8_t tx[1 + kNumRegisters] = { (uint8_t)(0b00100000 | reg) };  // Write, auto-increment
+    memcpy(tx + 1, data, len);
+    SpiTransaction transaction;
+    transaction.cs = &RTC_cs;
+    transaction.tx = tx;
+    transaction.length = 1 + len;
+    RTC_bus.transfer(transaction);
+}
+
+void PCF2129::readRegistersAsync(AsyncRead& request, uint8_t reg, size_t len,
+                                 Callback<void()> done) {
+    checkRange(reg, len);
+    memset(request.tx, 0, sizeof(request.tx));
+    request.tx[0] = 0b10100000 | reg;  // Read, auto-increment
+    request.transaction.cs = &RTC_cs;
+    request.transaction.tx = request.tx;
+    request.transaction.rx = request.rx;
+    request.transaction.length = 1 + len;
+    request.transaction.done = done;
+    RTC_bus.submit(request.transaction);
+}
+
+bool PCF2129::decodeTime(const uint8_t* regs, tm *time) {
+    uint8_t sec = regs[0];
+    uint8_t min = regs[1];
+    uint8_t hour = regs[2];
+    uint8_t day = regs[3];
+    uint8_t month = regs[5];
+    uint8_t year = regs[6];
 
     // Convert from device's BCD (binary coded decimal) format to int
     time->tm_sec = bcdToInt(sec & 0x7f);
@@ -42,42 +78,41 @@ bool PCF2129::gettime(tm *time) {
     return !(sec & 0x80);  // OSF bit
 }
 
+bool PCF2129::gettime(tm *time) {
+    /** Read the registers holding the time components, starting at the sec register */
+    uint8_t regs[kTimeLength];
+    readRegisters(kTimeRegister, regs, sizeof(regs));
+    return decodeTime(regs, time);
+}
+
+void PCF2129::gettimeAsync(AsyncRead& request, Callback<void()> done) {
+    readRegistersAsync(request, kTimeRegister, kTimeLength, done);
+}
+
+bool PCF2129::gettime(const AsyncRead& request, tm *time) {
+    return decodeTime(request.data(), time);
+}
+
 int PCF2129::settime(const tm &time) {
-    uint8_t command = 0b00100000;           //Write starting at the sec register
     // Convert to device's BCD (binary coded decimal) format
-    uint8_t sec = intToBcd(time.tm_sec);
-    uint8_t min = intToBcd(time.tm_min);
-    uint8_t hour = intToBcd(time.tm_hour);
-    uint8_t day = intToBcd(time.tm_mday);
-    uint8_t month = intToBcd(time.tm_mon) + 1;
-    uint8_t year = intToBcd(time.tm_year);
+    uint8_t regs[kTimeLength];
+    regs[0] = intToBcd(time.tm_sec);
+    regs[1] = intToBcd(time.tm_min);
+    regs[2] = intToBcd(time.tm_hour);
+    regs[3] = intToBcd(time.tm_mday);
+    regs[4] = 0;  // weekday
+    regs[5] = intToBcd(time.tm_mon + 1);
+    regs[6] = intToBcd(time.tm_year);
 
-    /** Write this out to the RTC */
-    RTC_cs = 0;
-    wait_us(1);
-    RTC_spi.write(command | 0x03);
-    RTC_spi.write(sec);
-    RTC_spi.write(min);
-    RTC_spi.write(hour);
-    RTC_spi.write(day);
-    RTC_spi.write(0);
-    RTC_spi.write(month);
-    RTC_spi.write(year);
-    RTC_cs = 1;
+    /** Write this out to the RTC, starting at the sec register */
+    writeRegisters(kTimeRegister, regs, sizeof(regs));
+    return 0;
 }
 
 void PCF2129::enable_s_int() {
     /** Set the configuration to enable the second interrupt */
-    int command = 0b00100000;
-    RTC_cs=0;
-    wait_us(1);
-    RTC_spi.write(command | 0x10);
-    RTC_spi.write(1<<5);
-    RTC_cs=1;
-    wait_us(5);
-    RTC_cs=0;
-    wait_us(1);
-    RTC_spi.write(command | 0x00);
-    RTC_spi.write(0x01);
-    RTC_cs=1;
+    uint8_t watchdogControl = 1<<5;  // TI_TP, pulsed interrupt
+    writeRegisters(0x10, &watchdogControl, 1);
+    uint8_t control1 = 0x01;  // SI, second interrupt enable
+    writeRegisters(0x00, &control1, 1);
 }
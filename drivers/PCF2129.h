@@ -11,23 +11,69 @@
 #include <mbed.h>
 #include <time.h>
 
+#include "SpiBus.h"
+
 /** Class abstraction for the PCF2129 */
 class PCF2129 {
 
 private:
-    SPI& RTC_spi;           // Pointer to SPI object that the RTC is connected to
+    BlockingSpiBus RTC_defaultBus;  // Bus used when no shared bus is given
+    SpiBus& RTC_bus;        // Bus that the RTC is connected to
     DigitalOut& RTC_cs;     // Pointer to Digital Out object that the RTC CS is connected to
 
 public:
+    static const uint8_t kNumRegisters = 0x1c;
+
+    /** Storage for an asynchronous register read, which must stay valid
+     * until the read completes (transaction.complete is set)
+     */
+    struct AsyncRead {
+        SpiTransaction transaction;
+        uint8_t tx[1 + kNumRegisters];
+        uint8_t rx[1 + kNumRegisters];
+
+        /** Register values, once the read completed */
+        const uint8_t* data() const {
+            return rx + 1;
+        }
+    };
 
     /** Constructor for PCF2129 object
      *
      * @param s Reference to an SPI object connected to the RTC
      * @param cs Reference to the DigitalOut object connected to the RTC CS pin
+     * @param bus Shared bus to queue transactions on (such as a DmaSpi), instead of using s directly
      */
-    PCF2129(SPI &s, DigitalOut &cs) : RTC_spi(s), RTC_cs(cs) {
+    PCF2129(SPI &s, DigitalOut &cs, SpiBus* bus = NULL) :
+        RTC_defaultBus(s), RTC_bus(bus != NULL ? *bus : RTC_defaultBus), RTC_cs(cs) {
     }
 
+    /** Read consecutive registers in a single transaction
+     *
+     * @param reg First register address
+     * @param data Output, len bytes
+     * @param len Number of registers, up to kNumRegisters
+     */
+    void readRegisters(uint8_t reg, uint8_t* data, size_t len);
+
+    /** Write consecutive registers in a single transaction
+     *
+     * @param reg First register address
+     * @param data Register values, len bytes
+     * @param len Number of registers, up to kNumRegisters
+     */
+    void writeRegisters(uint8_t reg, const uint8_t* data, size_t len);
+
+    /** Queue a read of consecutive registers on the bus without waiting
+     *
+     * @param request Storage for the transaction and data
+     * @param reg First register address
+     * @param len Number of registers, up to kNumRegisters
+     * @param done Called on completion, possibly from interrupt context
+     */
+    void readRegistersAsync(AsyncRead& request, uint8_t reg, size_t len,
+                            Callback<void()> done = Callback<void()>());
+
     /** Read the current time and put it in time.
      * RTC MUST BE SET IN 24 HOUR MODE, not 12 hour AM/PM mode.
      *
@@ -37,6 +83,20 @@ public:
      */
     bool gettime(tm *time);
 
+    /** Queue a read of the current time without waiting, decode it with
+     * gettime(request, time) once complete
+     *
+     * @param request Storage for the transaction and data
+     * @param done Called on completion, possibly from interrupt context
+     */
+    void gettimeAsync(AsyncRead& request, Callback<void()> done = Callback<void()>());
+
+    /** Decode the time from a completed gettimeAsync
+     *
+     * @return if the oscillator hasn't stopped (if the OSF bit is clear)
+     */
+    static bool gettime(const AsyncRead& request, tm *time);
+
     /** Set the time on the RTC from the datetime object
      * RTC MUST BE SET IN 24 HOUR MODE, not 12 hour AM/PM mode.
      *
@@ -49,6 +109,13 @@ public:
      */
     void enable_s_int();
 
+private:
+    // Register address and count of the time registers, starting at the sec register
+    static const uint8_t kTimeRegister = 0x03;
+    static const size_t kTimeLength = 7;
+
+    static void checkRange(uint8_t reg, size_t len);
+    static bool decodeTime(const uint8_t* regs, tm *time);
 };
 
 #endif // __PCF_2129_H__
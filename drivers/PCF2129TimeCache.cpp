@@ -0,0 +1,71 @@
+/**
+ * PCF2129TimeCache.cpp
+ */
+
+#include "PCF2129TimeCache.h"
+#include "CalendarTime.h"
+
+PCF2129TimeCache::PCF2129TimeCache(PCF2129& rtc, LongTimer& timebase)
+    : rtc(rtc), timebase(timebase), anchorSeconds_(0), anchorTimebaseUs_(0),
+      valid_(false), subsecondValid_(false) {
+}
+
+bool PCF2129TimeCache::sync() {
+    tm time;
+    bool oscillatorOk = rtc.gettime(&time);
+    time_t seconds = calsol::util::calendarToEpoch(time);
+    uint64_t now = timebase.read_us();
+
+    __disable_irq();
+    anchorSeconds_ = seconds;
+    anchorTimebaseUs_ = now;
+    subsecondValid_ = false;
+    valid_ = true;
+    __enable_irq();
+    return oscillatorOk;
+}
+
+void PCF2129TimeCache::onSecondEdge() {
+    if (!valid_) {
+        return;
+    }
+    uint64_t now = timebase.read_us();
+
+    __disable_irq();  // higher priority interrupts may read the anchor
+    uint64_t elapsed = now - anchorTimebaseUs_;
+    if (subsecondValid_) {
+        // Anchored at the previous edge, round in case of timebase drift
+        anchorSeconds_ += (elapsed + 500000) / 1000000;
+    } else {
+        // Anchored somewhere inside a second, this edge ends that second
+        anchorSeconds_ += elapsed / 1000000 + 1;
+    }
+    anchorTimebaseUs_ = now;
+    subsecondValid_ = true;
+    __enable_irq();
+}
+
+void PCF2129TimeCache::readAnchor(time_t& seconds, uint64_t& timebase_us) {
+    __disable_irq();
+    seconds = anchorSeconds_;
+    timebase_us = anchorTimebaseUs_;
+    __enable_irq();
+}
+
+time_t PCF2129TimeCache::read() {
+    time_t seconds;
+    uint64_t anchorUs;
+    readAnchor(seconds, anchorUs);
+    return seconds + (uint32_t)((timebase.read_us() - anchorUs) / 1000000);
+}
+
+uint64_t PCF2129TimeCache::read_us() {
+    time_t seconds;
+    uint64_t anchorUs;
+    readAnchor(seconds, anchorUs);
+    return (uint64_t)seconds * 1000000 + (timebase.read_us() - anchorUs);
+}
+
+void PCF2129TimeCache::read(tm* time) {
+    calsol::util::epochToCalendar(read(), time);
+}
@@ -0,0 +1,92 @@
+/**
+ * PCF2129TimeCache.h
+ *
+ *  Cached wall-clock time from a PCF2129, derived from LongTimer deltas so reads don't need
+ *  SPI transactions
+ */
+
+#ifndef __PCF2129_TIME_CACHE_H__
+#define __PCF2129_TIME_CACHE_H__
+
+#include <mbed.h>
+#include <time.h>
+
+#include "PCF2129.h"
+#include "LongTimer.h"
+
+/** Wall-clock time source that reads the PCF2129 once, then extrapolates with a LongTimer.
+ *
+ *  Each second interrupt (see PCF2129::enable_s_int) re-anchors the cached time to the exact
+ *  RTC second boundary without any SPI traffic, which also gives sub-second resolution.
+ *  Until the first second edge after sync(), sub-second time is only accurate to within a second.
+ *
+ *  Typical usage:
+ *    PCF2129TimeCache rtcTime(rtc, longTimer);
+ *    InterruptIn rtcInt(P0_1);
+ *
+ *    void main() {
+ *        rtc.enable_s_int();
+ *        rtcTime.sync();
+ *        rtcInt.rise(callback(&rtcTime, &PCF2129TimeCache::onSecondEdge));
+ *        ...
+ *        time_t now = rtcTime.read();
+ *    }
+ */
+class PCF2129TimeCache {
+public:
+    /** Create a time cache, which is invalid until sync() is called
+     *
+     *  @param rtc RTC to read the time from
+     *  @param timebase running LongTimer used to extrapolate between reads
+     */
+    PCF2129TimeCache(PCF2129& rtc, LongTimer& timebase);
+
+    /** Read the time from the RTC (blocking SPI) and anchor the cache to it
+     *
+     *  @returns if the RTC oscillator hasn't stopped, as PCF2129::gettime
+     */
+    bool sync();
+
+    /** Call on each RTC second interrupt edge, typically from the interrupt handler
+     */
+    void onSecondEdge();
+
+    /** Returns whether sync() has been called
+     */
+    bool valid() const {
+        return valid_;
+    }
+
+    /** Returns whether sub-second time is aligned to a second edge
+     */
+    bool subsecondValid() const {
+        return subsecondValid_;
+    }
+
+    /** Returns the current time, in seconds since the Unix epoch
+     */
+    time_t read();
+
+    /** Returns the current time, in microseconds since the Unix epoch
+     */
+    uint64_t read_us();
+
+    /** Returns the current time as UTC calendar time
+     */
+    void read(tm* time);
+
+private:
+    /** Snapshot the anchor with interrupts disabled, since the second edge interrupt updates it
+     */
+    void readAnchor(time_t& seconds, uint64_t& timebase_us);
+
+    PCF2129& rtc;
+    LongTimer& timebase;
+
+    volatile time_t anchorSeconds_;  // RTC time at the anchor
+    volatile uint64_t anchorTimebaseUs_;  // LongTimer time at the anchor
+    volatile bool valid_;
+    volatile bool subsecondValid_;  // anchor is at a second edge, rather than at an arbitrary sync()
+};
+
+#endif // __PCF2129_TIME_CACHE_H__
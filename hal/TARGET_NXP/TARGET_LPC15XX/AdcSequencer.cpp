@@ -0,0 +1,105 @@
+#include "AdcSequencer.h"
+
+#include "AnalogPeripherals.h"
+
+const uint32_t SYSCON_SYSAHBCLKCTRL0_MUX = 1 << 11;
+
+const uint32_t ADCn_SEQ_CTRL_CHANNELS = 0xfff;
+const uint32_t ADCn_SEQ_CTRL_TRIGGER_SHIFT = 12;
+const uint32_t ADCn_SEQ_CTRL_TRIGPOL = 1 << 18;
+const uint32_t ADCn_SEQ_CTRL_BURST = 1UL << 27;
+const uint32_t ADCn_SEQ_CTRL_SEQ_ENA = 1UL << 31;
+const uint32_t ADCn_INTEN_SEQA_INTEN = 1 << 0;
+
+// DMA_ITRIG_INMUX sources
+const uint32_t INMUX_DMA_ITRIG_ADC0_SEQA = 0;
+const uint32_t INMUX_DMA_ITRIG_ADC1_SEQA = 2;
+
+// DMA channel CFG fields
+const uint32_t DMA_CFG_HWTRIGEN = 1 << 1;
+const uint32_t DMA_CFG_TRIGPOL_HIGH = 1 << 4;
+const uint32_t DMA_CFG_TRIGBURST = 1 << 6;
+const uint32_t DMA_CFG_CHPRIORITY_LOWEST = 0x7 << 16;
+
+static decltype(LPC_ADC0) adcRegs(uint8_t adc) {
+  return adc == 0 ? LPC_ADC0 : LPC_ADC1;
+}
+
+AdcSequencerBase::AdcSequencerBase(uint8_t adc, uint16_t* buffers, size_t bufferSamples) :
+    adc_(adc), buffers_(buffers), bufferSamples_(bufferSamples),
+    numChannels_(0), secondHalfNext_(false) {
+  if (adc > 1) {
+    error("Unknown ADC");
+  }
+  dmaChannel_ = DmaController::get().allocateChannel();
+  if (dmaChannel_ == DmaController::kNoChannel) {
+    error("No DMA channel for ADC sequencer");
+  }
+  AdcManager::get().calibrate(adc);
+}
+
+void AdcSequencerBase::start(uint16_t channelMask, uint8_t trigger,
+    Callback<void(const AdcBlock&)> callback) {
+  stop();
+
+  numChannels_ = __builtin_popcount(channelMask & ADCn_SEQ_CTRL_CHANNELS);
+  if (numChannels_ == 0 || numChannels_ > bufferSamples_) {
+    error("ADC sequence does not fit buffer");
+  }
+  size_t numFrames = bufferSamples_ / numChannels_;
+  callback_ = callback;
+  secondHalfNext_ = false;
+
+  // In end-of-conversion mode, each result raises the sequence interrupt, and reading the
+  // global data register clears it. Used as a DMA trigger, this moves each result as it is
+  // converted, and sequences convert channels in ascending order so frames come out interleaved.
+  DmaController::Transfer transfer;
+  transfer.src = &adcRegs(adc_)->SEQA_GDAT;  // result is in the low half-word
+  transfer.count = numFrames * numChannels_;
+  transfer.width = DmaController::kWidth16;
+  transfer.dstIncrement = DmaController::kIncrement1;
+  transfer.srcIncrement = DmaController::kIncrementNone;
+  transfer.periphRequest = false;
+  transfer.dst = buffers_;
+  DmaController::buildDescriptor(descriptors_[0], transfer, true, false, descriptors_[1]);
+  transfer.dst = buffers_ + bufferSamples_;
+  DmaController::buildDescriptor(descriptors_[1], transfer, true, false, descriptors_[0]);
+
+  LPC_SYSCON->SYSAHBCLKCTRL0 |= SYSCON_SYSAHBCLKCTRL0_MUX;
+  LPC_INMUX->DMA_ITRIG_INMUX[dmaChannel_] =
+      adc_ == 0 ? INMUX_DMA_ITRIG_ADC0_SEQA : INMUX_DMA_ITRIG_ADC1_SEQA;
+  DmaController::get().startDescriptor(dmaChannel_,
+      DMA_CFG_HWTRIGEN | DMA_CFG_TRIGPOL_HIGH | DMA_CFG_TRIGBURST | DMA_CFG_CHPRIORITY_LOWEST,
+      descriptors_[0],
+      Callback<void()>(this, &AdcSequencerBase::irqBufferDone));
+
+  // The sequence interrupt only drives the DMA trigger, it is not enabled in the NVIC
+  adcRegs(adc_)->INTEN |= ADCn_INTEN_SEQA_INTEN;
+  uint32_t seqCtrl = channelMask & ADCn_SEQ_CTRL_CHANNELS;
+  if (trigger == kTriggerBurst) {
+    seqCtrl |= ADCn_SEQ_CTRL_BURST;
+  } else {
+    seqCtrl |= ((trigger & 0x7) << ADCn_SEQ_CTRL_TRIGGER_SHIFT) | ADCn_SEQ_CTRL_TRIGPOL;
+  }
+  adcRegs(adc_)->SEQA_CTRL = seqCtrl;  // sequence must be configured while disabled
+  adcRegs(adc_)->SEQA_CTRL = seqCtrl | ADCn_SEQ_CTRL_SEQ_ENA;
+}
+
+void AdcSequencerBase::stop() {
+  adcRegs(adc_)->SEQA_CTRL &= ~(ADCn_SEQ_CTRL_SEQ_ENA | ADCn_SEQ_CTRL_BURST);
+  adcRegs(adc_)->INTEN &= ~ADCn_INTEN_SEQA_INTEN;
+  DmaController::get().stop(dmaChannel_);
+}
+
+void AdcSequencerBase::irqBufferDone() {
+  AdcBlock block;
+  block.samples = secondHalfNext_ ? buffers_ + bufferSamples_ : buffers_;
+  block.numChannels = numChannels_;
+  block.numFrames = bufferSamples_ / numChannels_;
+  block.secondHalf = secondHalfNext_;
+  secondHalfNext_ = !secondHalfNext_;
+
+  if (callback_) {
+    callback_(block);
+  }
+}
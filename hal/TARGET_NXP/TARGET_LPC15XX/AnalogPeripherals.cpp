@@ -1,21 +1,41 @@
 #include "AnalogPeripherals.h"
+#include "SupplyCompensator.h"
 
 #include "analogin_api.h"
 #include "pinmap.h"
 
 const uint32_t ADCn_INSEL_ADC = 0x0;
 const uint32_t ADCn_INSEL_CORE = 0x1;
-const uint32_t ADCn_INSEL_BANDGAP = 0x2;
-const uint32_t ADCn_INSEL_TEMPERATURE = 0x3;
 const uint32_t SYSCON_PDRUNCFG_TS_PD = 1 << 18;
 const uint32_t SYSCON_PDRUNCFG_IREF_PD = 1 << 17;
+const uint32_t SYSCON_PDRUNCFG_ADC0_PD = 1 << 10;
+const uint32_t SYSCON_PDRUNCFG_ADC1_PD = 1 << 11;
+const uint32_t SYSCON_SYSAHBCLKCTRL0_ADC0 = 1 << 27;
+const uint32_t SYSCON_SYSAHBCLKCTRL0_ADC1 = 1 << 28;
+
+AdcManager::AdcManager() : internalSourcesPowered_(false) {
+  calibrated_[0] = false;
+  calibrated_[1] = false;
+  internalAdc_.adc = ADC0_0;
+}
 
-BandgapReference::BandgapReference() {
-  LPC_SYSCON->PDRUNCFG &= ~(SYSCON_PDRUNCFG_IREF_PD | SYSCON_PDRUNCFG_TS_PD);  // enable bandgap sensor
+void AdcManager::calibrate(uint8_t adc) {
+  if (adc > 1) {
+    error("Unknown ADC");
+  }
+  if (calibrated_[adc]) {
+    return;
+  }
+  decltype(LPC_ADC0) adcRegs = adc == 0 ? LPC_ADC0 : LPC_ADC1;
 
   // power up ADC
-  LPC_SYSCON->PDRUNCFG &= ~(1 << 10);
-  LPC_SYSCON->SYSAHBCLKCTRL0 |= (1 << 27);
+  if (adc == 0) {
+    LPC_SYSCON->PDRUNCFG &= ~SYSCON_PDRUNCFG_ADC0_PD;
+    LPC_SYSCON->SYSAHBCLKCTRL0 |= SYSCON_SYSAHBCLKCTRL0_ADC0;
+  } else {
+    LPC_SYSCON->PDRUNCFG &= ~SYSCON_PDRUNCFG_ADC1_PD;
+    LPC_SYSCON->SYSAHBCLKCTRL0 |= SYSCON_SYSAHBCLKCTRL0_ADC1;
+  }
   // select IRC as asynchronous clock, divided by 1
   LPC_SYSCON->ADCASYNCCLKSEL  = 0;
   LPC_SYSCON->ADCASYNCCLKDIV  = 1;
@@ -24,62 +44,103 @@ BandgapReference::BandgapReference() {
   uint32_t clkdiv = (SystemCoreClock / 500000) - 1;
 
   // perform a self-calibration
-  LPC_ADC0->CTRL = (1UL << 30) | (clkdiv & 0xFF);
-  while ((LPC_ADC0->CTRL & (1UL << 30)) != 0);
+  adcRegs->CTRL = (1UL << 30) | (clkdiv & 0xFF);
+  while ((adcRegs->CTRL & (1UL << 30)) != 0);
 
   // switch to asynchronous mode
-  LPC_ADC0->CTRL = (1UL << 8);
+  adcRegs->CTRL = (1UL << 8);
 
-  _adc.adc = ADC0_0;
+  calibrated_[adc] = true;
 }
 
-float BandgapReference::read() {
-  LPC_ADC0->INSEL = ADCn_INSEL_BANDGAP;
-  float readOut = analogin_read(&_adc);
+void AdcManager::powerInternalSources() {
+  if (internalSourcesPowered_) {
+    return;
+  }
+  LPC_SYSCON->PDRUNCFG &= ~(SYSCON_PDRUNCFG_IREF_PD | SYSCON_PDRUNCFG_TS_PD);  // enable bandgap sensor
+  internalSourcesPowered_ = true;
+}
+
+unsigned short AdcManager::read_u16(Source source) {
+  __disable_irq();
+  LPC_ADC0->INSEL = source;
+  unsigned short readOut = analogin_read_u16(&internalAdc_);
   LPC_ADC0->INSEL = ADCn_INSEL_ADC;
+  __enable_irq();
   return readOut;
 }
 
-unsigned short BandgapReference::read_u16() {
-  LPC_ADC0->INSEL = ADCn_INSEL_BANDGAP;
-  unsigned short readOut = analogin_read_u16(&_adc);
+float AdcManager::read(Source source) {
+  __disable_irq();
+  LPC_ADC0->INSEL = source;
+  float readOut = analogin_read(&internalAdc_);
   LPC_ADC0->INSEL = ADCn_INSEL_ADC;
+  __enable_irq();
   return readOut;
 }
 
-TempSensor::TempSensor() {
-  LPC_SYSCON->PDRUNCFG &= ~(SYSCON_PDRUNCFG_IREF_PD | SYSCON_PDRUNCFG_TS_PD);  // enable bandgap sensor
+bool AdcManager::request(Source source, Callback<void(unsigned short)> callback) {
+  Request request;
+  request.source = source;
+  request.callback = callback;
+
+  __disable_irq();  // requests may come from several threads and interrupts
+  if (requests_.full()) {
+    __enable_irq();
+    return false;
+  }
+  requests_.write(request);
+  __enable_irq();
+  return true;
+}
 
-  // power up ADC
-  LPC_SYSCON->PDRUNCFG &= ~(1 << 10);
-  LPC_SYSCON->SYSAHBCLKCTRL0 |= (1 << 27);
-  // select IRC as asynchronous clock, divided by 1
-  LPC_SYSCON->ADCASYNCCLKSEL  = 0;
-  LPC_SYSCON->ADCASYNCCLKDIV  = 1;
+void AdcManager::service() {
+  while (true) {
+    __disable_irq();
+    if (requests_.empty()) {
+      __enable_irq();
+      break;
+    }
+    Request request = requests_.read();
+    __enable_irq();
+
+    unsigned short readOut = read_u16(request.source);
+    if (request.callback) {
+      request.callback(readOut);
+    }
+  }
+}
 
-  // determine the system clock divider for a 500kHz ADC clock during calibration
-  uint32_t clkdiv = (SystemCoreClock / 500000) - 1;
+BandgapReference::BandgapReference() {
+  AdcManager::get().powerInternalSources();
+  AdcManager::get().calibrate(0);
+}
 
-  // perform a self-calibration
-  LPC_ADC0->CTRL = (1UL << 30) | (clkdiv & 0xFF);
-  while ((LPC_ADC0->CTRL & (1UL << 30)) != 0);
+float BandgapReference::read() {
+  return AdcManager::get().read(AdcManager::kBandgap);
+}
 
-  // switch to asynchronous mode
-  LPC_ADC0->CTRL = (1UL << 8);
+unsigned short BandgapReference::read_u16() {
+  return AdcManager::get().read_u16(AdcManager::kBandgap);
+}
 
-  _adc.adc = ADC0_0;
+TempSensor::TempSensor() {
+  AdcManager::get().powerInternalSources();
+  AdcManager::get().calibrate(0);
 }
 
 float TempSensor::read() {
-  LPC_ADC0->INSEL = ADCn_INSEL_TEMPERATURE;
-  float readOut = analogin_read(&_adc);
-  LPC_ADC0->INSEL = ADCn_INSEL_ADC;
-  return readOut;
+  return AdcManager::get().read(AdcManager::kTemperature);
 }
 
 unsigned short TempSensor::read_u16() {
-  LPC_ADC0->INSEL = ADCn_INSEL_TEMPERATURE;
-  unsigned short readOut = analogin_read_u16(&_adc);
-  LPC_ADC0->INSEL = ADCn_INSEL_ADC;
-  return readOut;
+  return AdcManager::get().read_u16(AdcManager::kTemperature);
+}
+
+int16_t TempSensor::read_centidegrees(const SupplyCompensator* compensator) {
+  unsigned short readOut = read_u16();
+  if (compensator != NULL) {
+    readOut = compensator->correct(readOut);
+  }
+  return tempSensorCentidegrees(readOut);
 }
@@ -0,0 +1,231 @@
+#include "AsyncI2C.h"
+
+// STAT and INTENSET bits
+const uint32_t kMstPending = 1 << 0;
+const uint32_t kMstStateShift = 1;
+const uint32_t kMstStateMask = 0x7 << kMstStateShift;
+const uint32_t kMstArbLoss = 1 << 4;
+const uint32_t kMstStStpErr = 1 << 6;
+
+// MSTSTATE values
+const uint32_t kMstStateIdle = 0;
+const uint32_t kMstStateRxReady = 1;
+const uint32_t kMstStateTxReady = 2;
+const uint32_t kMstStateNackAddress = 3;
+const uint32_t kMstStateNackData = 4;
+
+// MSTCTL bits
+const uint32_t kMstContinue = 1 << 0;
+const uint32_t kMstStart = 1 << 1;
+const uint32_t kMstStop = 1 << 2;
+
+AsyncI2C* AsyncI2C::instance_ = NULL;
+
+AsyncI2C::AsyncI2C(PinName sda, PinName scl) :
+    I2C(sda, scl), head_(NULL), tail_(NULL), step_(kStepIdle), attempt_(0), numDevices_(0) {
+  if (instance_ != NULL) {
+    error("Only one AsyncI2C allowed");
+  }
+  instance_ = this;
+
+  NVIC_SetVector(I2C0_IRQn, (uint32_t)&irqHandlerStatic);
+  NVIC_EnableIRQ(I2C0_IRQn);
+}
+
+void AsyncI2C::submit(I2cTransaction& transaction) {
+  transaction.status = I2cTransaction::kPending;
+  transaction.next_ = NULL;
+  transaction.merged_ = NULL;
+
+  __disable_irq();  // the queue is shared with the interrupt
+  if (head_ == NULL) {
+    head_ = &transaction;
+    tail_ = &transaction;
+  } else if (!transaction.read && tail_ != head_ && !tail_->read
+      && tail_->address == transaction.address && tail_->reg == transaction.reg) {
+    // The head may already be on the bus, only a later queued write can take the new value
+    tail_->value = transaction.value;
+    I2cTransaction** mergedEnd = &tail_->merged_;
+    while (*mergedEnd != NULL) {
+      mergedEnd = &(*mergedEnd)->merged_;
+    }
+    *mergedEnd = &transaction;
+    DeviceStats* stats = deviceStats(transaction.address);
+    if (stats != NULL) {
+      stats->merged++;
+    }
+  } else {
+    tail_->next_ = &transaction;
+    tail_ = &transaction;
+  }
+  // If the master is idle, MSTPENDING is already set and the interrupt starts the transaction
+  LPC_I2C0->INTENSET = kMstPending | kMstArbLoss | kMstStStpErr;
+  __enable_irq();
+}
+
+void AsyncI2C::startTransaction() {
+  step_ = kStepAddress;
+  LPC_I2C0->MSTDAT = head_->address & ~1;  // write, for the register address
+  LPC_I2C0->MSTCTL = kMstStart;
+}
+
+void AsyncI2C::finishTransaction(I2cTransaction::Status status) {
+  I2cTransaction* transaction = head_;
+  __disable_irq();  // submit may be called from higher priority interrupts
+  DeviceStats* stats = deviceStats(transaction->address);
+  head_ = transaction->next_;
+  __enable_irq();
+  attempt_ = 0;
+
+  // Callbacks may submit and reuse the transactions, which start once the master is idle
+  while (transaction != NULL) {
+    I2cTransaction* merged = transaction->merged_;
+    if (stats != NULL) {
+      stats->transactions++;
+      if (status == I2cTransaction::kNak) {
+        stats->naks++;
+      } else if (status == I2cTransaction::kBusError) {
+        stats->busErrors++;
+      }
+    }
+    transaction->status = status;
+    if (transaction->done) {
+      transaction->done();
+    }
+    transaction = merged;
+  }
+}
+
+void AsyncI2C::handleError(I2cTransaction::Status status) {
+  if (attempt_ < kMaxRetries) {
+    attempt_++;  // the head restarts once the master is idle
+    __disable_irq();
+    DeviceStats* stats = deviceStats(head_->address);
+    if (stats != NULL) {
+      stats->retries++;
+    }
+    __enable_irq();
+  } else {
+    finishTransaction(status);
+  }
+}
+
+void AsyncI2C::irqHandler() {
+  uint32_t stat = LPC_I2C0->STAT;
+
+  if (stat & (kMstArbLoss | kMstStStpErr)) {
+    // The master returns to idle by itself
+    LPC_I2C0->STAT = kMstArbLoss | kMstStStpErr;  // write 1 to clear
+    if (step_ != kStepIdle) {
+      step_ = kStepIdle;
+      handleError(I2cTransaction::kBusError);
+    }
+    return;
+  }
+  if (!(stat & kMstPending)) {
+    return;
+  }
+
+  uint32_t state = (stat & kMstStateMask) >> kMstStateShift;
+  if (step_ == kStepIdle) {
+    // MSTDAT and MSTCTL may only be written with MSTPENDING set, so every transaction (including
+    // retries) starts here, once the master is idle after the previous stop
+    if (state != kMstStateIdle) {
+      return;
+    }
+    __disable_irq();
+    if (head_ == NULL) {
+      LPC_I2C0->INTENCLR = kMstPending | kMstArbLoss | kMstStStpErr;
+      __enable_irq();
+      return;
+    }
+    __enable_irq();
+    startTransaction();
+    return;
+  }
+
+  I2cTransaction& transaction = *head_;
+  if (state == kMstStateNackAddress || state == kMstStateNackData) {
+    LPC_I2C0->MSTCTL = kMstStop;
+    step_ = kStepIdle;
+    handleError(I2cTransaction::kNak);
+    return;
+  }
+
+  switch (step_) {
+  case kStepIdle:
+    break;
+  case kStepAddress:
+    if (state != kMstStateTxReady) break;
+    LPC_I2C0->MSTDAT = transaction.reg;
+    LPC_I2C0->MSTCTL = kMstContinue;
+    step_ = kStepRegister;
+    return;
+  case kStepRegister:
+    if (state != kMstStateTxReady) break;
+    if (transaction.read) {
+      LPC_I2C0->MSTDAT = transaction.address | 1;
+      LPC_I2C0->MSTCTL = kMstStart;  // repeated start
+      step_ = kStepReadAddress;
+    } else {
+      LPC_I2C0->MSTDAT = transaction.value;
+      LPC_I2C0->MSTCTL = kMstContinue;
+      step_ = kStepValue;
+    }
+    return;
+  case kStepValue:
+    if (state != kMstStateTxReady) break;
+    LPC_I2C0->MSTCTL = kMstStop;
+    step_ = kStepIdle;
+    finishTransaction(I2cTransaction::kOk);
+    return;
+  case kStepReadAddress:
+    if (state != kMstStateRxReady) break;
+    transaction.value = LPC_I2C0->MSTDAT;
+    LPC_I2C0->MSTCTL = kMstStop;
+    step_ = kStepIdle;
+    finishTransaction(I2cTransaction::kOk);
+    return;
+  }
+
+  // Unexpected master state
+  if (state != kMstStateIdle) {
+    LPC_I2C0->MSTCTL = kMstStop;
+  }
+  step_ = kStepIdle;
+  handleError(I2cTransaction::kBusError);
+}
+
+void AsyncI2C::irqHandlerStatic() {
+  instance_->irqHandler();
+}
+
+AsyncI2C::DeviceStats* AsyncI2C::deviceStats(int address) {
+  for (size_t i=0; i<numDevices_; i++) {
+    if (stats_[i].address == address) {
+      return &stats_[i];
+    }
+  }
+  if (numDevices_ >= kMaxDevices) {
+    return NULL;
+  }
+  DeviceStats& stats = stats_[numDevices_++];
+  memset(&stats, 0, sizeof(stats));
+  stats.address = address;
+  return &stats;
+}
+
+const AsyncI2C::DeviceStats* AsyncI2C::readDeviceStats(int address) const {
+  for (size_t i=0; i<numDevices_; i++) {
+    if (stats_[i].address == address) {
+      return &stats_[i];
+    }
+  }
+  return NULL;
+}
+
+void AsyncI2C::resetStats() {
+  __disable_irq();
+  numDevices_ = 0;
+  __enable_irq();
+}
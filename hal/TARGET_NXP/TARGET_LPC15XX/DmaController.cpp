@@ -1,12 +1,17 @@
 #include "DmaController.h"
+#include "Trace.h"
 
 uint32_t DmaController::dmaDescriptors_[18][4] __attribute__((aligned(512)));
 Callback<void()> DmaController::dmaCallbacks_[kNumDmaChannels];
+uint32_t DmaController::callbackMask_ = 0;
+DmaController::IrqStats DmaController::irqStats_[kNumDmaChannels];
+DmaController::ChunkState DmaController::chunkStates_[kNumDmaChannels];
+uint32_t DmaController::allocatedChannels_ = 0;
 
 void DmaController::memToPeriphTransfer(volatile void* dst, void* src, size_t len,
     uint8_t channel, void (*callback)()) {
   if (callback) {
-    dmaCallbacks_[channel] = callback;
+    setCallback(channel, callback);
     memToPeriphTransfer(dst, src, len, channel, true);
   } else {
     memToPeriphTransfer(dst, src, len, channel, false);
@@ -22,24 +27,234 @@ DmaController::DmaController() {
   LPC_DMA->CTRL = 1;
   LPC_DMA->SRAMBASE = (uint32_t)dmaDescriptors_;
 
+  // Enable the cycle counter, used for interrupt handler timing
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
   NVIC_SetVector(DMA_IRQn, (uint32_t)&irqHandler);
   NVIC_EnableIRQ(DMA_IRQn);
 }
 
+void DmaController::setCallback(uint8_t channel, Callback<void()> callback) {
+  dmaCallbacks_[channel] = callback;
+  __disable_irq();  // mask is shared with transfers started from other channels' interrupts
+  if (callback) {
+    callbackMask_ |= 1 << channel;
+  } else {
+    callbackMask_ &= ~(1 << channel);
+  }
+  __enable_irq();
+}
+
+DmaController::IrqStats DmaController::readIrqStats(uint8_t channel) const {
+  return irqStats_[channel];
+}
+
+void DmaController::resetIrqStats() {
+  __disable_irq();
+  for (uint8_t i=0; i<kNumDmaChannels; i++) {
+    irqStats_[i].count = 0;
+    irqStats_[i].maxCycles = 0;
+  }
+  __enable_irq();
+}
+
+int8_t DmaController::allocateChannel(Request request) {
+  int8_t channel = kNoChannel;
+  __disable_irq();
+  if (request != kNoRequest) {
+    if (!(allocatedChannels_ & (1 << request))) {
+      channel = request;
+    }
+  } else {
+    // Search downwards, so channels without request lines are used up first
+    for (int8_t i=kNumDmaChannels-1; i>=0; i--) {
+      if (!(allocatedChannels_ & (1 << i))) {
+        channel = i;
+        break;
+      }
+    }
+  }
+  if (channel != kNoChannel) {
+    allocatedChannels_ |= 1 << channel;
+  }
+  __enable_irq();
+  return channel;
+}
+
+void DmaController::freeChannel(uint8_t channel) {
+  if (busy(channel)) {
+    error("DMA channel freed while active");
+  }
+  __disable_irq();
+  allocatedChannels_ &= ~(1 << channel);
+  __enable_irq();
+}
+
+bool DmaController::busy(uint8_t channel) {
+  return (LPC_DMA->ACTIVE0 & (1 << channel)) || chunkStates_[channel].remaining > 0;
+}
+
+void DmaController::transfer(uint8_t channel, const Transfer& transfer,
+    Callback<void()> callback) {
+  setCallback(channel, callback);
+  startTransfer(channel, transfer, bool(callback));
+}
+
 void DmaController::memToPeriphTransfer(volatile void* dst, void* src, size_t len,
     uint8_t channel, bool interrupt) {
-  // ensure channel isn't in use
-  if (LPC_DMA->ACTIVE0 & (1 << channel)) {
+  Transfer transfer;
+  transfer.dst = dst;
+  transfer.src = src;
+  transfer.count = len;
+  transfer.width = kWidth8;
+  transfer.dstIncrement = kIncrementNone;
+  transfer.srcIncrement = kIncrement1;
+  transfer.periphRequest = true;
+  startTransfer(channel, transfer, interrupt);
+}
+
+void DmaController::periphToMemTransfer(void* dst, const volatile void* src, size_t len,
+    uint8_t channel, Width width, Callback<void()> callback) {
+  Transfer transfer;
+  transfer.dst = dst;
+  transfer.src = src;
+  transfer.count = len >> width;
+  transfer.width = width;
+  transfer.dstIncrement = kIncrement1;
+  transfer.srcIncrement = kIncrementNone;
+  transfer.periphRequest = true;
+  this->transfer(channel, transfer, callback);
+}
+
+void DmaController::memcpyAsync(uint8_t channel, void* dst, const void* src, size_t len,
+    Callback<void()> callback) {
+  if (busy(channel)) {
     error("DMA channel already active");
   }
-  if (len > 1024) {
+  if (len == 0) {
+    if (callback) {
+      callback();
+    }
+    return;
+  }
+  ChunkState& state = chunkStates_[channel];
+  state.dst = (uint8_t*)dst;
+  state.src = (const uint8_t*)src;
+  state.width = alignedWidth((uintptr_t)dst, (uintptr_t)src, len);
+  setCallback(channel, callback);
+  state.remaining = len;
+  startChunk(channel);
+}
+
+void DmaController::memsetAsync(uint8_t channel, void* dst, uint8_t value, size_t len,
+    Callback<void()> callback) {
+  if (busy(channel)) {
+    error("DMA channel already active");
+  }
+  if (len == 0) {
+    if (callback) {
+      callback();
+    }
+    return;
+  }
+  ChunkState& state = chunkStates_[channel];
+  state.dst = (uint8_t*)dst;
+  state.src = NULL;
+  state.fillWord = value * 0x01010101UL;
+  state.width = alignedWidth((uintptr_t)dst, 0, len);
+  setCallback(channel, callback);
+  state.remaining = len;
+  startChunk(channel);
+}
+
+void DmaController::startChunk(uint8_t channel) {
+  ChunkState& state = chunkStates_[channel];
+  size_t chunkLen = std::min(state.remaining, kDmaMaxTransfers << state.width);
+
+  Transfer transfer;
+  transfer.dst = state.dst;
+  transfer.count = chunkLen >> state.width;
+  transfer.width = state.width;
+  transfer.dstIncrement = kIncrement1;
+  if (state.src != NULL) {
+    transfer.src = state.src;
+    transfer.srcIncrement = kIncrement1;
+    state.src += chunkLen;
+  } else {
+    transfer.src = &state.fillWord;
+    transfer.srcIncrement = kIncrementNone;
+  }
+  transfer.periphRequest = false;
+
+  state.dst += chunkLen;
+  state.remaining -= chunkLen;
+  // Always interrupt, even without a callback, so the remaining chunks get started
+  get().startTransfer(channel, transfer, true);
+}
+
+DmaController::Width DmaController::alignedWidth(uintptr_t dst, uintptr_t src, size_t len) {
+  uintptr_t alignment = dst | src | len;
+  if ((alignment & 0x3) == 0) {
+    return kWidth32;
+  } else if ((alignment & 0x1) == 0) {
+    return kWidth16;
+  } else {
+    return kWidth8;
+  }
+}
+
+void DmaController::buildDescriptor(uint32_t descriptor[4], const Transfer& transfer,
+    bool interrupt, bool softwareTrigger, const uint32_t* next) {
+  if (transfer.count > kDmaMaxTransfers || transfer.count == 0) {
     error("DMA transfer length exceeds maximum");
   }
 
+  // Descriptors hold end addresses: the address of the last transfer
+  uint32_t lastOffset = (transfer.count - 1) << transfer.width;
+  uint32_t srcStride = transfer.srcIncrement ? 1 << (transfer.srcIncrement - 1) : 0;
+  uint32_t dstStride = transfer.dstIncrement ? 1 << (transfer.dstIncrement - 1) : 0;
+
+  descriptor[0] = 1 | ((next != NULL) << 1) | (softwareTrigger << 2) | (interrupt << 4)
+      | (transfer.width << 8)
+      | (transfer.srcIncrement << 12) | (transfer.dstIncrement << 14)
+      | ((transfer.count - 1) << 16);
+  descriptor[1] = (uint32_t)transfer.src + lastOffset * srcStride;  // source end address
+  descriptor[2] = (uint32_t)transfer.dst + lastOffset * dstStride;  // destination end address
+  descriptor[3] = (uint32_t)next;  // next descriptor
+}
+
+void DmaController::startDescriptor(uint8_t channel, uint32_t channelCfg,
+    const uint32_t descriptor[4], Callback<void()> callback) {
+  setCallback(channel, callback);
+  startChannel(channel, channelCfg, descriptor, bool(callback));
+}
+
+void DmaController::stop(uint8_t channel) {
+  chunkStates_[channel].remaining = 0;
+  LPC_DMA->ENABLECLR0 = 1 << channel;
+  while (LPC_DMA->BUSY0 & (1 << channel));
+  LPC_DMA->ABORT0 = 1 << channel;
+  LPC_DMA->INTA0 = 1 << channel;  // drop any interrupt from the aborted transfer
+}
+
+void DmaController::startTransfer(uint8_t channel, const Transfer& transfer, bool interrupt) {
+  uint32_t descriptor[4];
+  buildDescriptor(descriptor, transfer, interrupt, true, NULL);
+  startChannel(channel, (transfer.periphRequest ? 1 : 0) | (0x7 << 16), descriptor, interrupt);
+}
+
+void DmaController::startChannel(uint8_t channel, uint32_t channelCfg,
+    const uint32_t descriptor[4], bool interrupt) {
+  // ensure channel isn't in use
+  if (LPC_DMA->ACTIVE0 & (1 << channel)) {
+    error("DMA channel already active");
+  }
+
   dmaDescriptors_[channel][0] = 0;
-  dmaDescriptors_[channel][1] = (uint32_t)src + len - 1;  // source end address
-  dmaDescriptors_[channel][2] = (uint32_t)dst;  // destination end address
-  dmaDescriptors_[channel][3] = 0;  // next descriptor
+  dmaDescriptors_[channel][1] = descriptor[1];  // source end address
+  dmaDescriptors_[channel][2] = descriptor[2];  // destination end address
+  dmaDescriptors_[channel][3] = descriptor[3];  // next descriptor
 
   if (interrupt) {
     LPC_DMA->INTENSET0 = 1 << channel;
@@ -48,18 +263,36 @@ void DmaController::memToPeriphTransfer(volatile void* dst, void* src, size_t le
   }
 
   LPC_DMA->ENABLESET0 = 1 << channel;  // enable channel
-  volatile uint32_t* channelCfg = &LPC_DMA->CFG0 + 4 * channel;
-  volatile uint32_t* xferCfg = &LPC_DMA->XFERCFG0 + 4 * channel;
-  *channelCfg = 1 | (0x7 << 16);
-  *xferCfg = 1 | (1 << 2) | (interrupt << 4) | (0x1 << 12) | ((len - 1) << 16);
+  volatile uint32_t* channelCfgReg = &LPC_DMA->CFG0 + 4 * channel;
+  volatile uint32_t* xferCfgReg = &LPC_DMA->XFERCFG0 + 4 * channel;
+  *channelCfgReg = channelCfg;
+  *xferCfgReg = descriptor[0];
   LPC_DMA->SETVALID0 = 1 << channel;  // channel valid
 }
 
 void DmaController::irqHandler() {
-  for (uint8_t i=0; i<kNumDmaChannels; i++) {
-    if (LPC_DMA->INTA0 & (1 << i)) {
-      LPC_DMA->INTA0 = 1 << i;  // setting bit clears interrupt
-      dmaCallbacks_[i]();
+  // Read and clear the pending mask once, instead of a peripheral bus read per channel
+  uint32_t pending = LPC_DMA->INTA0;
+  LPC_DMA->INTA0 = pending;  // setting bit clears interrupt
+
+  while (pending != 0) {
+    uint8_t channel = __builtin_ctz(pending);  // lowest pending channel first
+    pending &= pending - 1;
+
+    TRACE_BEGIN(calsol::util::trace::kIdDmaIrq, channel);
+    uint32_t startCycles = DWT->CYCCNT;
+    if (chunkStates_[channel].remaining > 0) {
+      startChunk(channel);
+    } else if (callbackMask_ & (1 << channel)) {
+      dmaCallbacks_[channel]();
+    }
+    uint32_t cycles = DWT->CYCCNT - startCycles;
+    TRACE_END(calsol::util::trace::kIdDmaIrq, channel);
+
+    IrqStats& stats = irqStats_[channel];
+    stats.count++;
+    if (cycles > stats.maxCycles) {
+      stats.maxCycles = cycles;
     }
   }
 }
@@ -1,4 +1,5 @@
 #include "DmaSerial.h"
+#include "Trace.h"
 
 DmaSerialBase::DmaSerialBase(PinName tx, PinName rx, int baud, uint8_t* bufferBegin, uint8_t* bufferEnd) :
     RawSerial(tx, rx), bufferBegin_(bufferBegin), bufferEnd_(bufferEnd) {
@@ -8,15 +9,169 @@ DmaSerialBase::DmaSerialBase(PinName tx, PinName rx, int baud, uint8_t* bufferBe
   queueStart_.store(bufferBegin_);
   queueEnd_.store(bufferBegin_);
   dmaRunning_.store(false);
+  overflowPolicy_ = kReject;
+  blockTimeoutUs_ = 0;
+  dmaStartUs_ = 0;
+  resetStats();
+
+  int8_t channel = DmaController::get().allocateChannel(dmaRequest());
+  if (channel == DmaController::kNoChannel) {
+    error("DMA channel for serial already in use");
+  }
+  dmaChannel_ = channel;
+}
+
+void DmaSerialBase::setOverflowPolicy(OverflowPolicy policy, uint32_t blockTimeout_us) {
+  overflowPolicy_ = policy;
+  blockTimeoutUs_ = blockTimeout_us;
+}
+
+DmaSerialBase::Stats DmaSerialBase::readStats() const {
+  Stats stats;
+  stats.bytesQueued = bytesQueued_;
+  stats.bytesDropped = bytesDropped_;
+  stats.rejectedCalls = rejectedCalls_;
+  stats.highWaterMark = highWaterMark_;
+  stats.dmaTransfers = dmaTransfers_;
+  stats.dmaBytes = dmaBytes_;
+  stats.dmaBusyUs = dmaBusyUs_;
+  return stats;
+}
+
+size_t DmaSerialBase::averageTransferSize() const {
+  uint32_t transfers = dmaTransfers_;
+  if (transfers == 0) {
+    return 0;
+  }
+  return (dmaBytes_ + transfers / 2) / transfers;  // rounding divide
+}
+
+void DmaSerialBase::resetStats() {
+  bytesQueued_ = 0;
+  bytesDropped_ = 0;
+  rejectedCalls_ = 0;
+  highWaterMark_ = 0;
+  dmaTransfers_ = 0;
+  dmaBytes_ = 0;
+  dmaBusyUs_ = 0;
+}
+
+size_t DmaSerialBase::queueFree(uint8_t* queueStart, uint8_t* queueEnd) {
+  size_t used;
+  if (queueStart <= queueEnd) {  // queue does not wrap around
+    used = queueEnd - queueStart;
+  } else {  // queue wraps around
+    used = (bufferEnd_ - bufferBegin_) - (queueStart - queueEnd);
+  }
+  return (bufferEnd_ - bufferBegin_) - used - 1;  // one element always left empty
+}
+
+void DmaSerialBase::updateHighWaterMark() {
+  size_t used = (bufferEnd_ - bufferBegin_) - 1
+      - queueFree(queueStart_.load(std::memory_order_relaxed),
+                  queueEnd_.load(std::memory_order_relaxed));
+  if (used > highWaterMark_) {
+    highWaterMark_ = used;
+  }
+}
+
+bool DmaSerialBase::handleOverflow(uint8_t*& data, size_t& len) {
+  switch (overflowPolicy_) {
+  case kTruncate: {
+    size_t available = queueFree(queueStart_.load(std::memory_order_relaxed),
+                                 queueEnd_.load(std::memory_order_relaxed));
+    bytesDropped_ += len - available;
+    rejectedCalls_++;
+    len = available;
+    return len > 0;
+  }
+  case kDropOldest: {
+    __disable_irq();  // freeze the DMA completion interrupt while the queue is rearranged
+    dropOldest(len);
+    size_t available = queueFree(queueStart_.load(std::memory_order_relaxed),
+                                 queueEnd_.load(std::memory_order_relaxed));
+    __enable_irq();
+    if (len > available) {  // longer than all droppable space, keep only the newest new data
+      bytesDropped_ += len - available;
+      rejectedCalls_++;
+      data += len - available;
+      len = available;
+    }
+    return len > 0;
+  }
+  case kBlock: {
+    if (len <= (size_t)(bufferEnd_ - bufferBegin_) - 1) {  // can ever fit
+      uint32_t startUs = us_ticker_read();
+      while (len > queueFree(queueStart_.load(std::memory_order_acquire),
+                             queueEnd_.load(std::memory_order_relaxed))) {
+        if (us_ticker_read() - startUs >= blockTimeoutUs_) {
+          break;
+        }
+      }
+      if (len <= queueFree(queueStart_.load(std::memory_order_acquire),
+                           queueEnd_.load(std::memory_order_relaxed))) {
+        return true;
+      }
+    }
+    // fall through to reject on timeout
+  }
+  case kReject:
+  default:
+    bytesDropped_ += len;
+    rejectedCalls_++;
+    return false;
+  }
+}
+
+void DmaSerialBase::dropOldest(size_t len) {
+  // Must be called with interrupts disabled.
+  // Bytes are discarded without moving any data. With the DMA idle, the oldest bytes are dropped
+  // by advancing queueStart_. While a transfer runs, data between queueStart_ and
+  // nextBufferStart_ belongs to it, and the oldest pending bytes are not next to the free space,
+  // so all pending data is dropped by pulling queueEnd_ back to nextBufferStart_.
+  size_t bufferSize = bufferEnd_ - bufferBegin_;
+  uint8_t* queueStart = queueStart_.load(std::memory_order_relaxed);
+  uint8_t* queueEnd = queueEnd_.load(std::memory_order_relaxed);
+  bool dmaRunning = dmaRunning_.load(std::memory_order_relaxed);
+  uint8_t* pendingStart = dmaRunning ? nextBufferStart_ : queueStart;
+
+  size_t pending;
+  if (pendingStart <= queueEnd) {
+    pending = queueEnd - pendingStart;
+  } else {
+    pending = bufferSize - (pendingStart - queueEnd);
+  }
+  size_t available = queueFree(queueStart, queueEnd);
+  if (len <= available) {
+    return;
+  }
+
+  if (dmaRunning) {
+    queueEnd_.store(pendingStart, std::memory_order_relaxed);
+    bytesDropped_ += pending;
+  } else {
+    size_t drop = std::min(len - available, pending);
+    pendingStart += drop;
+    if (pendingStart >= bufferEnd_) {
+      pendingStart -= bufferSize;
+    }
+    queueStart_.store(pendingStart, std::memory_order_relaxed);
+    bytesDropped_ += drop;
+  }
 }
 
 int DmaSerialBase::putc(int character) {
   uint8_t* queueEnd = queueEnd_.load(std::memory_order_relaxed);
   uint8_t* queueStart = queueStart_.load(std::memory_order_relaxed);
 
-  if (queueEnd == queueStart - 1
-      || (queueStart == bufferBegin_ && queueEnd == bufferEnd_ - 1)) {
-    return EOF;
+  if (queueFree(queueStart, queueEnd) == 0) {
+    uint8_t byte = (uint8_t)character;
+    uint8_t* data = &byte;
+    size_t len = 1;
+    if (!handleOverflow(data, len)) {
+      return EOF;
+    }
+    queueEnd = queueEnd_.load(std::memory_order_relaxed);
   }
   *queueEnd = (uint8_t)character;
   queueEnd++;
@@ -24,6 +179,8 @@ int DmaSerialBase::putc(int character) {
     queueEnd = bufferBegin_;
   }
   queueEnd_.store(queueEnd, std::memory_order_relaxed);
+  bytesQueued_++;
+  updateHighWaterMark();
 
   if (!dmaRunning_.load(std::memory_order_acq_rel)) {
     startTransfer();
@@ -41,20 +198,19 @@ int DmaSerialBase::puts(const char* str) {
 }
 
 bool DmaSerialBase::put(uint8_t* data, size_t len) {
-  size_t remaining;
-  uint8_t* queueEnd = queueEnd_.load(std::memory_order_relaxed);
-  uint8_t* queueStart = queueStart_.load(std::memory_order_relaxed);
-  if (queueStart < queueEnd) {  // queue does not wrap around
-    remaining = (bufferEnd_ - bufferBegin_) - (queueEnd - queueStart);
-  } else if (queueStart > queueEnd ) {  // queue wraps around
-    remaining = queueStart - queueEnd;
-  } else {  // empty queue
-    remaining = bufferEnd_ - bufferBegin_;
-  }
-  if (remaining < len + 1) {
-    return false;
+  bool complete = true;
+  if (len > queueFree(queueStart_.load(std::memory_order_relaxed),
+                      queueEnd_.load(std::memory_order_relaxed))) {
+    size_t requestedLen = len;
+    if (!handleOverflow(data, len)) {
+      return false;
+    }
+    complete = (len == requestedLen);
   }
+  bytesQueued_ += len;
+  TRACE_INSTANT(calsol::util::trace::kIdSerialPut, len);
 
+  uint8_t* queueEnd = queueEnd_.load(std::memory_order_relaxed);
   size_t remainingContinuous = bufferEnd_ - queueEnd;
   size_t transferContinuous = std::min(len, remainingContinuous);
   memcpy(queueEnd, data, transferContinuous);
@@ -66,20 +222,21 @@ bool DmaSerialBase::put(uint8_t* data, size_t len) {
   } else {
     queueEnd_.store(queueEnd + transferContinuous, std::memory_order_relaxed);
   }
+  updateHighWaterMark();
 
   if (!dmaRunning_.load(std::memory_order_acq_rel)) {
     startTransfer();
   }
-  return true;
+  return complete;
 }
 
-uint8_t DmaSerialBase::dmaChannel() {
-  // Select DMA channel with the request input for this USART
+DmaController::Request DmaSerialBase::dmaRequest() {
+  // Select the DMA request input for this USART
   switch (_serial.index) {
-  case 0: return 1;
-  case 1: return 3;
-  case 2: return 5;
-  default: error("Unknown DMA channel for serial"); return 0;
+  case 0: return DmaController::kUsart0Tx;
+  case 1: return DmaController::kUsart1Tx;
+  case 2: return DmaController::kUsart2Tx;
+  default: error("Unknown DMA channel for serial"); return DmaController::kNoRequest;
   }
 }
 
@@ -102,15 +259,22 @@ void DmaSerialBase::startTransfer() {
     error("Empty queue");
   }
 
+  dmaTransfers_++;
+  dmaBytes_ += len;
+  dmaStartUs_ = us_ticker_read();
+  TRACE_ASYNC_BEGIN(calsol::util::trace::kIdSerialDma, len);
+
   dmaRunning_.store(true, std::memory_order_release);
   DmaController::get().memToPeriphTransfer(
       &(_serial.uart->TXDATA),
       queueStart, len,
-      dmaChannel(),
+      dmaChannel_,
       this, &DmaSerialBase::irqTransferDone);
 }
 
 void DmaSerialBase::irqTransferDone() {
+  dmaBusyUs_ += us_ticker_read() - dmaStartUs_;
+  TRACE_ASYNC_END(calsol::util::trace::kIdSerialDma, 0);
   queueStart_.store(nextBufferStart_);
 
   // Inside interrupt, memory ordering not an issue
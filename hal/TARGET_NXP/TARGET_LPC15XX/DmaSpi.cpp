@@ -0,0 +1,98 @@
+#include "DmaSpi.h"
+
+const uint8_t DmaSpi::kDummyTx;
+
+DmaSpi::DmaSpi(PinName mosi, PinName miso, PinName sclk) :
+    SPI(mosi, miso, sclk), head_(NULL), tail_(NULL) {
+  DmaController::Request rxRequest, txRequest;
+  if (_spi.spi == LPC_SPI0) {
+    rxRequest = DmaController::kSpi0Rx;
+    txRequest = DmaController::kSpi0Tx;
+  } else {
+    rxRequest = DmaController::kSpi1Rx;
+    txRequest = DmaController::kSpi1Tx;
+  }
+  int8_t rxChannel = DmaController::get().allocateChannel(rxRequest);
+  int8_t txChannel = DmaController::get().allocateChannel(txRequest);
+  if (rxChannel == DmaController::kNoChannel || txChannel == DmaController::kNoChannel) {
+    error("SPI DMA channels in use");
+  }
+  rxChannel_ = rxChannel;
+  txChannel_ = txChannel;
+}
+
+void DmaSpi::submit(SpiTransaction& transaction) {
+  if (transaction.length == 0 || transaction.length > kDmaMaxTransfers) {
+    error("Bad SPI transaction length");
+  }
+  transaction.complete = false;
+  transaction.next_ = NULL;
+
+  __disable_irq();  // the queue is shared with completion callbacks
+  bool wasIdle = (head_ == NULL);
+  if (wasIdle) {
+    head_ = &transaction;
+  } else {
+    tail_->next_ = &transaction;
+  }
+  tail_ = &transaction;
+  __enable_irq();
+
+  if (wasIdle) {
+    startTransaction();
+  }
+}
+
+void DmaSpi::startTransaction() {
+  SpiTransaction& transaction = *head_;
+  LPC_SPI0_Type* spi = _spi.spi;
+
+  while (spi->STAT & (1 << 0)) {  // drain stale RXRDY data, so it isn't taken by the DMA
+    (void)spi->RXDAT;
+  }
+  // 8-bit frames, no hardware SSEL (chip select is a GPIO), for the TXDAT writes from the DMA
+  spi->TXCTL = (0xf << 16) | (7 << 24);
+
+  if (transaction.cs != NULL) {
+    *transaction.cs = 0;
+  }
+
+  DmaController::Transfer rx;
+  rx.dst = transaction.rx != NULL ? transaction.rx : &dummyRx_;
+  rx.src = &spi->RXDAT;
+  rx.count = transaction.length;
+  rx.width = DmaController::kWidth8;
+  rx.dstIncrement = transaction.rx != NULL ? DmaController::kIncrement1 : DmaController::kIncrementNone;
+  rx.srcIncrement = DmaController::kIncrementNone;
+  rx.periphRequest = true;
+  DmaController::get().transfer(rxChannel_, rx, callback(this, &DmaSpi::irqTransactionDone));
+
+  DmaController::Transfer tx;
+  tx.dst = &spi->TXDAT;
+  tx.src = transaction.tx != NULL ? transaction.tx : &kDummyTx;
+  tx.count = transaction.length;
+  tx.width = DmaController::kWidth8;
+  tx.dstIncrement = DmaController::kIncrementNone;
+  tx.srcIncrement = transaction.tx != NULL ? DmaController::kIncrement1 : DmaController::kIncrementNone;
+  tx.periphRequest = true;
+  DmaController::get().transfer(txChannel_, tx);
+}
+
+void DmaSpi::irqTransactionDone() {
+  SpiTransaction& transaction = *head_;
+  if (transaction.cs != NULL) {
+    *transaction.cs = 1;
+  }
+
+  __disable_irq();  // submit may be called from higher priority interrupts
+  head_ = transaction.next_;
+  bool more = (head_ != NULL);
+  __enable_irq();
+  transaction.complete = true;
+  if (more) {
+    startTransaction();
+  }
+  if (transaction.done) {
+    transaction.done();  // last, since it may submit and reuse the transaction
+  }
+}
@@ -0,0 +1,61 @@
+#include "EepromCache.h"
+
+#include <algorithm>
+
+EepromCache::EepromCache() :
+    dirtyPages_(0), iapCommands_(0), pagesWritten_(0) {
+}
+
+void EepromCache::load() {
+  EEPROM::read(0, shadow_, EEPROM::SIZE);
+  dirtyPages_ = 0;
+}
+
+void EepromCache::read(uint32_t address, uint8_t* data, uint32_t bytes) const {
+  if (address + bytes > EEPROM::SIZE) {
+    error("EEPROM read out of bounds");
+  }
+  memcpy(data, shadow_ + address, bytes);
+}
+
+void EepromCache::write(uint32_t address, const uint8_t* data, uint32_t bytes) {
+  if (address + bytes > EEPROM::SIZE) {
+    error("EEPROM write out of bounds");
+  }
+  // Go page by page, so pages where nothing changed stay clean
+  while (bytes > 0) {
+    uint32_t page = address / EEPROM::PAGE_BYTES;
+    uint32_t pageBytes = std::min(bytes, (page + 1) * EEPROM::PAGE_BYTES - address);
+    if (memcmp(shadow_ + address, data, pageBytes) != 0) {
+      memcpy(shadow_ + address, data, pageBytes);
+      dirtyPages_ |= (uint64_t)1 << page;
+    }
+    address += pageBytes;
+    data += pageBytes;
+    bytes -= pageBytes;
+  }
+}
+
+size_t EepromCache::flush() {
+  size_t commands = 0;
+  while (flushRun()) {
+    commands++;
+  }
+  return commands;
+}
+
+bool EepromCache::flushRun() {
+  if (dirtyPages_ == 0) {
+    return false;
+  }
+  uint32_t firstPage = __builtin_ctzll(dirtyPages_);
+  uint32_t numPages = __builtin_ctzll(~(dirtyPages_ >> firstPage));  // length of the dirty run
+
+  uint32_t address = firstPage * EEPROM::PAGE_BYTES;
+  EEPROM::write(address, shadow_ + address, numPages * EEPROM::PAGE_BYTES);
+  dirtyPages_ &= ~((((uint64_t)1 << numPages) - 1) << firstPage);
+
+  iapCommands_++;
+  pagesWritten_ += numPages;
+  return true;
+}
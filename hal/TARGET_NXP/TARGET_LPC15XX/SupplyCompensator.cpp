@@ -0,0 +1,39 @@
+#include "SupplyCompensator.h"
+
+SupplyCompensator::SupplyCompensator(BandgapReference& bandgap, Timer& timebase,
+    uint32_t period_us, uint16_t bandgap_mV, uint16_t nominalVdd_mV) :
+    bandgap_(bandgap), ticker_(period_us, timebase),
+    bandgap_mV_(bandgap_mV), nominalVdd_mV_(nominalVdd_mV),
+    sampled_(false), filteredBandgap_(0), gainQ15_(1 << 15), vdd_mV_(nominalVdd_mV) {
+}
+
+bool SupplyCompensator::update() {
+  if (sampled_ && !ticker_.checkExpired()) {
+    return false;
+  }
+  addBandgapSample(bandgap_.read_u16());
+  return true;
+}
+
+void SupplyCompensator::addBandgapSample(uint16_t bandgapReading) {
+  if (bandgapReading == 0) {  // not a plausible reading, and would divide by zero
+    return;
+  }
+  uint32_t sample = (uint32_t)bandgapReading << kBandgapFractionBits;
+  if (!sampled_) {
+    filteredBandgap_ = sample;
+    sampled_ = true;
+  } else {
+    filteredBandgap_ = filteredBandgap_ - (filteredBandgap_ >> kFilterShift)
+        + (sample >> kFilterShift);
+  }
+
+  // The bandgap reads as bandgap_mV / Vdd of full scale, so Vdd = bandgap_mV * 2^16 / reading.
+  // The divisions happen here, once per bandgap sample, instead of per corrected reading.
+  uint64_t scaledBandgap = (uint64_t)bandgap_mV_ << (16 + kBandgapFractionBits);
+  uint32_t vdd_mV = scaledBandgap / filteredBandgap_;
+  vdd_mV_ = vdd_mV > 0xffff ? 0xffff : vdd_mV;
+
+  uint64_t gainQ15 = (scaledBandgap << 15) / ((uint64_t)filteredBandgap_ * nominalVdd_mV_);
+  gainQ15_ = gainQ15 >= (2 << 15) ? (2 << 15) - 1 : gainQ15;
+}
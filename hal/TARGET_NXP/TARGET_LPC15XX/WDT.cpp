@@ -24,6 +24,22 @@ void WDT::setTimeout(uint32_t timeout_us) {
     LPC_WWDT->TC=TCValue; //Load the value into the register
 }
 
+void WDT::setWarning(uint32_t warning_us) {
+    uint32_t WarningValue;
+    WarningValue = warning_us*503/4000; //Same conversion as the timeout
+    if(WarningValue > 1023) { //WARNINT is only 10 bits
+        WarningValue = 1023;
+    }
+    LPC_WWDT->WARNINT = WarningValue; //Interrupt fires when the counter reaches this value
+    clearWarning();
+    NVIC_ClearPendingIRQ(WDT_IRQn);
+    NVIC_EnableIRQ(WDT_IRQn);
+}
+
+void WDT::clearWarning() {
+    LPC_WWDT->MOD |= (1<<3); //Writing 1 to WDINT clears the warning interrupt flag
+}
+
 void WDT::enable() {
     LPC_WWDT->MOD |= 0x01; //set enable bit
     feed(); //feed once to start
@@ -0,0 +1,106 @@
+#ifdef TARGET_LPC15XX
+
+#include "mbed.h"
+#include "us_ticker_api.h"
+
+#include "crc.h"
+#include "WdtPostMortem.h"
+
+namespace WdtPostMortem {
+
+const uint32_t kMagic = 0x574d5254;  // "WMRT"
+
+static Record savedRecord __attribute__((section(".noinit")));
+static Record bootRecord;  // copy of savedRecord from boot, so a new capture can't overwrite it
+static bool bootRecordValid = false;
+
+static WDT* watchdog = NULL;
+static volatile uint32_t loopMarks[kNumLoopMarks];
+static volatile uint8_t loopMarkIndex = 0;  // next loopMarks entry to be written
+static volatile uint8_t currentTask = kNoTask;
+static volatile uint32_t counters[kNumCounters];
+
+static uint32_t recordCrc(Record& record) {
+  return CRC32::compute((uint8_t*)&record, offsetof(Record, crc));
+}
+
+/**
+ * Fills in the record, called from the warning handler with the stacked exception frame:
+ * r0, r1, r2, r3, r12, lr, pc, xpsr. Only referenced from the asm below, so marked used.
+ */
+extern "C" __attribute__((used)) void wdt_postmortem_capture(uint32_t* frame) {
+  Record& record = savedRecord;
+  record.magic = kMagic;
+  record.lr = frame[5];
+  record.pc = frame[6];
+  record.capture_us = us_ticker_read();
+  uint8_t index = loopMarkIndex;
+  for (uint8_t i=0; i<kNumLoopMarks; i++) {
+    record.loopMarks_us[i] = loopMarks[(index + i) % kNumLoopMarks];
+  }
+  for (uint8_t i=0; i<kNumCounters; i++) {
+    record.counters[i] = counters[i];
+  }
+  record.task = currentTask;
+  record.reserved[0] = record.reserved[1] = record.reserved[2] = 0;
+  record.crc = recordCrc(record);
+
+  watchdog->clearWarning();
+}
+
+/**
+ * Warning interrupt entry, passes the stack the exception frame was pushed onto.
+ */
+extern "C" __attribute__((naked)) void wdt_postmortem_irq() {
+  __asm volatile(
+    "tst lr, #4\n"
+    "ite eq\n"
+    "mrseq r0, msp\n"
+    "mrsne r0, psp\n"
+    "b wdt_postmortem_capture\n"
+  );
+}
+
+void install(WDT& wdt, uint32_t warning_us) {
+  bootRecordValid = wdt.causedReset()
+      && savedRecord.magic == kMagic && savedRecord.crc == recordCrc(savedRecord);
+  if (bootRecordValid) {
+    bootRecord = savedRecord;
+  }
+  savedRecord.magic = 0;
+
+  watchdog = &wdt;
+  NVIC_SetVector(WDT_IRQn, (uint32_t)&wdt_postmortem_irq);
+  wdt.setWarning(warning_us);
+}
+
+void loopMark() {
+  uint8_t index = loopMarkIndex;
+  loopMarks[index] = us_ticker_read();
+  loopMarkIndex = (index + 1) % kNumLoopMarks;
+}
+
+void setTask(uint8_t task) {
+  currentTask = task;
+}
+
+void setCounter(uint8_t index, uint32_t value) {
+  counters[index] = value;
+}
+
+bool available() {
+  return bootRecordValid;
+}
+
+const Record& record() {
+  return bootRecord;
+}
+
+void clear() {
+  bootRecordValid = false;
+  savedRecord.magic = 0;
+}
+
+}
+
+#endif
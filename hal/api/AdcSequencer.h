@@ -0,0 +1,100 @@
+#ifndef _ADC_SEQUENCER_H_
+#define _ADC_SEQUENCER_H_
+
+#include "mbed.h"
+
+#include "DmaController.h"
+
+/**
+ * A completed buffer of channel-interleaved ADC sample frames.
+ * Samples are left-aligned 16-bit values, the same scale as analogin_read_u16.
+ */
+struct AdcBlock {
+  const uint16_t* samples;  // samples[frame * numChannels + channel index]
+  size_t numFrames;
+  uint8_t numChannels;
+  bool secondHalf;  // whether this is the second (pong) buffer
+
+  /**
+   * Returns a sample, where channelIndex is the position of the channel among the sequenced
+   * channels in ascending order (not the ADC input number).
+   */
+  uint16_t sample(size_t frame, uint8_t channelIndex) const {
+    return samples[frame * numChannels + channelIndex];
+  }
+
+  /**
+   * Feeds every sample of one channel, in order, into a filter with an update(sample) method,
+   * like MovingAverage.
+   */
+  template <typename F>
+  void feed(F& filter, uint8_t channelIndex) const {
+    for (size_t i=0; i<numFrames; i++) {
+      filter.update(sample(i, channelIndex));
+    }
+  }
+};
+
+/**
+ * ADC sequence A, streamed by DMA into a pair of ping-pong buffers.
+ * Each trigger converts every selected channel in ascending order, and the DMA copies each
+ * result as the conversion finishes, so the buffers fill with interleaved frames without CPU
+ * involvement. The callback fires from the DMA interrupt as each buffer fills, and that buffer
+ * must be consumed before the DMA wraps back around to it.
+ *
+ * Warning: takes over sequence A of the ADC, do not use with analogin on the same ADC.
+ */
+class AdcSequencerBase {
+public:
+  static const uint8_t kTriggerBurst = 0xff;  // free-running, convert back-to-back
+
+  /**
+   * Starts sampling.
+   *
+   * @param channelMask bitmask of ADC input channels to convert
+   * @param trigger ADC hardware trigger input (0-7) starting each sequence on a rising edge, or
+   *     kTriggerBurst
+   */
+  void start(uint16_t channelMask, uint8_t trigger, Callback<void(const AdcBlock&)> callback);
+
+  /**
+   * Stops sampling. Partially filled buffers are discarded.
+   */
+  void stop();
+
+protected:
+  AdcSequencerBase(uint8_t adc, uint16_t* buffers, size_t bufferSamples);
+
+  void irqBufferDone();
+
+  const uint8_t adc_;  // ADC index, 0 or 1
+  uint16_t* const buffers_;  // two consecutive buffers of bufferSamples_ each
+  const size_t bufferSamples_;
+
+  int8_t dmaChannel_;
+  uint8_t numChannels_;
+  bool secondHalfNext_;  // which buffer completes next
+  Callback<void(const AdcBlock&)> callback_;
+
+  uint32_t descriptors_[2][4] __attribute__((aligned(16)));  // ping, pong reload descriptors
+};
+
+/**
+ * @tparam NumChannels maximum number of channels sequenced
+ * @tparam FramesPerBuffer number of sample frames in each of the ping-pong buffers
+ */
+template <uint8_t NumChannels, size_t FramesPerBuffer>
+class AdcSequencer : public AdcSequencerBase {
+  static_assert(NumChannels * FramesPerBuffer <= kDmaMaxTransfers,
+      "buffer exceeds a single DMA descriptor");
+
+public:
+  AdcSequencer(uint8_t adc) :
+      AdcSequencerBase(adc, buffers_[0], NumChannels * FramesPerBuffer) {
+  }
+
+protected:
+  uint16_t buffers_[2][NumChannels * FramesPerBuffer];
+};
+
+#endif
@@ -5,6 +5,77 @@
 
 #include "mbed.h"
 
+#include "circular_buffer.h"
+#include "TempSensorTable.h"
+
+class SupplyCompensator;
+
+/**
+ * Singleton owner of the internal ADCs, shared between the internal analog sources and other
+ * ADC users.
+ * Powers up and self-calibrates each ADC only once, either lazily by the first user or
+ * explicitly at a chosen point during boot, and arbitrates the ADC0 internal input selection
+ * between clients.
+ */
+class AdcManager {
+public:
+  static AdcManager& get() {
+    static AdcManager instance;
+    return instance;
+  }
+
+  // Internal sources, as ADC0 INSEL values
+  enum Source {
+    kBandgap = 0x2,
+    kTemperature = 0x3,
+  };
+
+  /**
+   * Powers up and self-calibrates an ADC (0 or 1), blocking for the calibration.
+   * Later calls for the same ADC return immediately.
+   */
+  void calibrate(uint8_t adc);
+
+  /**
+   * Powers up the bandgap and temperature sensor. Later calls return immediately.
+   */
+  void powerInternalSources();
+
+  /**
+   * Converts an internal source, blocking. The input selection and conversion happen with
+   * interrupts disabled, so callers in other contexts can't select a different source midway.
+   */
+  unsigned short read_u16(Source source);
+  float read(Source source);
+
+  /**
+   * Queues a conversion, for contexts that shouldn't block on the ADC. The callback is fired
+   * with the result from service().
+   * May be called from any context, including interrupts.
+   *
+   * @returns false if the request queue is full
+   */
+  bool request(Source source, Callback<void(unsigned short)> callback);
+
+  /**
+   * Runs queued conversions and fires their callbacks. Call this regularly.
+   */
+  void service();
+
+protected:
+  AdcManager();
+
+  struct Request {
+    Source source;
+    Callback<void(unsigned short)> callback;
+  };
+
+  bool calibrated_[2];
+  bool internalSourcesPowered_;
+  analogin_t internalAdc_;  // ADC0 channel 0, which INSEL redirects to the internal sources
+  calsol::util::CircularBuffer<Request, 8> requests_;
+};
+
 // Internal bandgap reference with the internal ADC
 class BandgapReference {
 public:
@@ -12,9 +83,6 @@ public:
 
   float read();
   unsigned short read_u16();
-
-protected:
-    analogin_t _adc;
 };
 
 // Internal temperature sensor with the internal ADC
@@ -24,8 +92,12 @@ public:
   float read();
   unsigned short read_u16();
 
-protected:
-    analogin_t _adc;
+  /**
+   * Returns the temperature in hundredths of a degree C, using integer math only.
+   * If a supply compensator is given, the reading is first corrected for supply drift, since
+   * the conversion table assumes the nominal supply.
+   */
+  int16_t read_centidegrees(const SupplyCompensator* compensator = NULL);
 };
 
 #endif
@@ -0,0 +1,81 @@
+#ifndef _ASYNC_I2C_H_
+#define _ASYNC_I2C_H_
+
+#include "mbed.h"
+
+#include "I2cBus.h"
+
+/**
+ * Interrupt-driven I2C master: an I2cBus whose queued register transactions are run by a state
+ * machine in the I2C interrupt, so a slow or NAKing device doesn't stall the main loop.
+ * NAKs and bus errors are retried, and error and retry counts are kept per device address.
+ * The blocking I2C::read and I2C::write must not be used while transactions are queued.
+ */
+class AsyncI2C : public I2C, public I2cBus {
+public:
+  static const uint8_t kMaxRetries = 2;
+  static const size_t kMaxDevices = 8;  // number of addresses statistics are kept for
+
+  struct DeviceStats {
+    int address;
+    uint32_t transactions;  // completed transactions, including merged writes
+    uint32_t merged;  // writes merged into an earlier queued write
+    uint32_t retries;
+    uint32_t naks;  // transactions that failed with kNak
+    uint32_t busErrors;  // transactions that failed with kBusError
+  };
+
+  AsyncI2C(PinName sda, PinName scl);
+
+  void submit(I2cTransaction& transaction);
+
+  /**
+   * Returns whether no transactions are queued or running.
+   */
+  bool idle() const {
+    return head_ == NULL;
+  }
+
+  /**
+   * Returns the statistics for a device address, or NULL if it has not been used (or the table
+   * is full).
+   */
+  const DeviceStats* readDeviceStats(int address) const;
+
+  void resetStats();
+
+protected:
+  enum Step {
+    kStepIdle,  // no transaction on the bus, the next idle interrupt starts the head
+    kStepAddress,  // address (write) sent, register next
+    kStepRegister,  // register sent, value or repeated start next
+    kStepValue,  // value sent, stop next
+    kStepReadAddress,  // address (read) sent after repeated start, data next
+  };
+
+  // Starts the transaction at the head of the queue, only with the master idle and pending
+  void startTransaction();
+
+  // Completes the head transaction and removes it from the queue
+  void finishTransaction(I2cTransaction::Status status);
+
+  // Handles a NAK or bus error on the head transaction, which is retried or completed
+  void handleError(I2cTransaction::Status status);
+
+  DeviceStats* deviceStats(int address);
+
+  void irqHandler();
+  static void irqHandlerStatic();
+
+  static AsyncI2C* instance_;  // the LPC15xx has a single I2C
+
+  I2cTransaction* head_;  // running transaction, followed by queued ones
+  I2cTransaction* tail_;
+  Step step_;
+  uint8_t attempt_;
+
+  DeviceStats stats_[kMaxDevices];
+  size_t numDevices_;
+};
+
+#endif
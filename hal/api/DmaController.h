@@ -4,6 +4,7 @@
 #include "mbed.h"
 
 const uint8_t kNumDmaChannels = 18;
+const size_t kDmaMaxTransfers = 1024;  // maximum number of transfers in a single descriptor
 
 /**
  * Singleton DMA controller class, shared between multiple DMA peripherals.
@@ -18,6 +19,90 @@ public:
     return instance;
   }
 
+  /**
+   * Width of each individual transfer.
+   */
+  enum Width {
+    kWidth8 = 0,
+    kWidth16 = 1,
+    kWidth32 = 2,
+  };
+
+  /**
+   * Address increment after each transfer, in units of the transfer width.
+   */
+  enum Increment {
+    kIncrementNone = 0,
+    kIncrement1 = 1,
+    kIncrement2 = 2,
+    kIncrement4 = 3,
+  };
+
+  /**
+   * Peripheral DMA request lines. On the LPC15xx, each request line is hardwired to the DMA
+   * channel of the same number, and channels 14 through 17 have no request line.
+   */
+  enum Request {
+    kUsart0Rx = 0,
+    kUsart0Tx,
+    kUsart1Rx,
+    kUsart1Tx,
+    kUsart2Rx,
+    kUsart2Tx,
+    kSpi0Rx,
+    kSpi0Tx,
+    kSpi1Rx,
+    kSpi1Tx,
+    kI2c0Slave,
+    kI2c0Master,
+    kI2c0Monitor,
+    kDac,
+    kNoRequest,  // memory-to-memory or hardware triggered, any channel will do
+  };
+
+  static const int8_t kNoChannel = -1;
+
+  /**
+   * Claims a DMA channel.
+   * For a peripheral request, this is the channel hardwired to that request line.
+   * With kNoRequest, this prefers channels without a request line, then the highest-numbered
+   * unclaimed channel.
+   *
+   * @returns the channel number, or kNoChannel if no suitable channel is free
+   */
+  int8_t allocateChannel(Request request = kNoRequest);
+
+  /**
+   * Releases a channel claimed with allocateChannel. The channel must be idle.
+   */
+  void freeChannel(uint8_t channel);
+
+  /**
+   * Returns whether a transfer (including all chunks of a long memcpyAsync / memsetAsync) is
+   * still in progress on the channel.
+   */
+  bool busy(uint8_t channel);
+
+  /**
+   * Description of a single-descriptor transfer.
+   */
+  struct Transfer {
+    volatile void* dst;  // first destination address
+    const volatile void* src;  // first source address
+    size_t count;  // number of transfers, up to kDmaMaxTransfers
+    Width width;
+    Increment dstIncrement;
+    Increment srcIncrement;
+    bool periphRequest;  // pace the transfer with the channel's request line, otherwise runs immediately
+  };
+
+  /**
+   * Initiates a generic transfer on a channel, which must be idle.
+   * If callback is not empty, it is fired from the DMA interrupt on transfer completion.
+   */
+  void transfer(uint8_t channel, const Transfer& transfer,
+      Callback<void()> callback = Callback<void()>());
+
   /**
    * Initiates a memory-to-peripheral transfer, where the source address
    * increments but the destination does not.
@@ -27,9 +112,6 @@ public:
    * @param src source pointer, incrementing
    * @param len transfer length, in bytes
    * @param channel DMA channel to use, which can dictate things like request source
-   *
-   * TODO: channel is a hack for peripheral-specific constraints, needs a more
-   * general API.
    */
   void memToPeriphTransfer(volatile void* dst, void* src, size_t len,
       uint8_t channel, void (*callback)() = NULL);
@@ -38,20 +120,125 @@ public:
   template<typename T>
   void memToPeriphTransfer(volatile void* dst, void* src, size_t len,
         uint8_t channel, T* tptr, void (T::*mptr)(void)) {
-    dmaCallbacks_[channel] = Callback<void()>(tptr, mptr);
+    setCallback(channel, Callback<void()>(tptr, mptr));
     memToPeriphTransfer(dst, src, len, channel, true);
   }
 
+  /**
+   * Initiates a peripheral-to-memory transfer, where the destination address
+   * increments but the source does not.
+   *
+   * @param dst destination pointer, incrementing
+   * @param src source pointer (peripheral data register), non-incrementing
+   * @param len transfer length, in bytes, and must be a multiple of the width
+   * @param channel DMA channel to use, which dictates the request source
+   */
+  void periphToMemTransfer(void* dst, const volatile void* src, size_t len,
+      uint8_t channel, Width width = kWidth8, Callback<void()> callback = Callback<void()>());
+
+  /**
+   * Asynchronous memcpy on a channel without a request line (see allocateChannel).
+   * The widest transfer width allowed by the alignment of dst, src and len is used.
+   * Copies longer than a single descriptor are split into chunks, restarted from the DMA
+   * interrupt, and callback fires only after the last chunk.
+   * Neither buffer may be touched until completion.
+   */
+  void memcpyAsync(uint8_t channel, void* dst, const void* src, size_t len,
+      Callback<void()> callback = Callback<void()>());
+
+  /**
+   * Asynchronous memset, with the same constraints as memcpyAsync.
+   */
+  void memsetAsync(uint8_t channel, void* dst, uint8_t value, size_t len,
+      Callback<void()> callback = Callback<void()>());
+
+  /**
+   * Fills a descriptor (transfer configuration, source end address, destination end address,
+   * next descriptor) for a transfer, for building descriptor chains used with startDescriptor.
+   *
+   * @param interrupt whether completing this descriptor raises the channel interrupt
+   * @param softwareTrigger whether the descriptor starts immediately, instead of waiting for a
+   *     hardware trigger
+   * @param next descriptor to reload on completion, or NULL to stop. Linked descriptors must be
+   *     16-byte aligned and stay in memory while the channel runs.
+   */
+  static void buildDescriptor(uint32_t descriptor[4], const Transfer& transfer,
+      bool interrupt, bool softwareTrigger, const uint32_t* next);
+
+  /**
+   * Starts a channel from a descriptor built with buildDescriptor, for descriptor chains and
+   * hardware triggers that transfer() doesn't cover.
+   * The descriptor contents are copied, so it may be part of the chain it starts.
+   * If callback is not empty, it is fired on completion of every descriptor with interrupts.
+   *
+   * @param channelCfg value for the channel CFG register (request enable, trigger and
+   *     burst configuration, priority)
+   */
+  void startDescriptor(uint8_t channel, uint32_t channelCfg, const uint32_t descriptor[4],
+      Callback<void()> callback = Callback<void()>());
+
+  /**
+   * Aborts any transfer on the channel, including reloading descriptor chains.
+   */
+  void stop(uint8_t channel);
+
+  /**
+   * Per-channel interrupt dispatch statistics.
+   */
+  struct IrqStats {
+    uint32_t count;  // number of completion interrupts dispatched
+    uint32_t maxCycles;  // longest completion handling time, in CPU cycles
+  };
+
+  /**
+   * Returns the interrupt dispatch statistics for a channel.
+   */
+  IrqStats readIrqStats(uint8_t channel) const;
+
+  /**
+   * Clears the interrupt dispatch statistics of all channels.
+   */
+  void resetIrqStats();
+
 protected:
   DmaController();
 
+  // Sets the completion callback, keeping callbackMask_ in sync with the table.
+  static void setCallback(uint8_t channel, Callback<void()> callback);
+
   void memToPeriphTransfer(volatile void* dst, void* src, size_t len,
       uint8_t channel, bool interrupt);
 
+  // Programs and starts a single descriptor on an idle channel.
+  void startTransfer(uint8_t channel, const Transfer& transfer, bool interrupt);
+
+  // Loads a descriptor into an idle channel's table entry and starts it.
+  void startChannel(uint8_t channel, uint32_t channelCfg, const uint32_t descriptor[4],
+      bool interrupt);
+
+  // Starts the next chunk of a long memory-to-memory operation.
+  static void startChunk(uint8_t channel);
+
+  static Width alignedWidth(uintptr_t dst, uintptr_t src, size_t len);
+
   static void irqHandler();
 
   static uint32_t dmaDescriptors_[kNumDmaChannels][4];
   static Callback<void()> dmaCallbacks_[kNumDmaChannels];
+  static uint32_t callbackMask_;  // bitmask of channels with a non-empty dmaCallbacks_ entry
+  static IrqStats irqStats_[kNumDmaChannels];
+
+  // State of long memcpyAsync / memsetAsync operations, continued from the interrupt
+  struct ChunkState {
+    uint8_t* dst;
+    const uint8_t* src;  // NULL for memset, which uses fillWord
+    size_t remaining;  // bytes not yet handed to a descriptor
+    Width width;
+    uint32_t fillWord;  // memset source value, must stay in memory for the transfer
+  };
+  static ChunkState chunkStates_[kNumDmaChannels];
+
+  static uint32_t allocatedChannels_;  // bitmask of channels claimed by allocateChannel
 };
 
 #endif
@@ -13,12 +13,66 @@
  */
 class DmaSerialBase : public RawSerial {
 public:
+  /**
+   * What to do when a write does not fit in the queue.
+   */
+  enum OverflowPolicy {
+    kReject,  // discard the entire write (default)
+    kDropOldest,  // discard queued data not yet handed to the DMA to make room
+    kTruncate,  // queue as much of the write as fits, discard the rest
+    kBlock,  // busy-wait for space up to the block timeout, then reject
+  };
+
+  /**
+   * Throughput and backpressure counters, for sizing the queue and baud rate.
+   */
+  struct Stats {
+    uint32_t bytesQueued;  // bytes accepted into the queue
+    uint32_t bytesDropped;  // bytes discarded by the overflow policy, either new or old data
+    uint32_t rejectedCalls;  // putc / put calls that could not queue all their data
+    size_t highWaterMark;  // maximum queue occupancy seen, in bytes
+    uint32_t dmaTransfers;  // number of DMA transfers started
+    uint32_t dmaBytes;  // total bytes sent through DMA transfers
+    uint32_t dmaBusyUs;  // total time the DMA channel was running, in us
+  };
+
   DmaSerialBase(PinName tx, PinName rx, int baud, uint8_t* bufferBegin, uint8_t* bufferEnd);
 
   int putc(int character);
   int puts(const char* str);
+
+  /**
+   * Queues data for transmission. Returns true if all of data was queued, false if any of it
+   * was discarded under the overflow policy (data discarded by kDropOldest does not count).
+   */
   bool put(uint8_t* data, size_t len);
 
+  /**
+   * Sets the overflow policy. The timeout only applies to kBlock.
+   * kBlock must not be used from interrupt context or while the DMA interrupt is masked, since
+   * space is only freed by the DMA completion interrupt.
+   * kDropOldest briefly disables interrupts while discarding data. While a DMA transfer is
+   * running, all data queued behind it is discarded at once, since only that makes room
+   * without moving data.
+   */
+  void setOverflowPolicy(OverflowPolicy policy, uint32_t blockTimeout_us = 0);
+
+  /**
+   * Returns a snapshot of the statistics counters.
+   * Counters updated by the DMA interrupt may be slightly inconsistent with the others.
+   */
+  Stats readStats() const;
+
+  /**
+   * Returns the average DMA transfer size in bytes, or zero if no transfers happened.
+   */
+  size_t averageTransferSize() const;
+
+  /**
+   * Clears the statistics counters.
+   */
+  void resetStats();
+
 protected:
   uint8_t* const bufferBegin_;
   uint8_t* const bufferEnd_;
@@ -32,7 +86,32 @@ protected:
   uint8_t* nextBufferStart_;  // queueStart_ becomes this after a DMA transfer completes
   atomic<bool> dmaRunning_;
 
-  uint8_t dmaChannel();
+  OverflowPolicy overflowPolicy_;
+  uint32_t blockTimeoutUs_;
+
+  // Producer-side counters, only modified by the writing thread
+  uint32_t bytesQueued_;
+  uint32_t bytesDropped_;
+  uint32_t rejectedCalls_;
+  size_t highWaterMark_;
+  // Consumer-side counters, only modified with the DMA channel owned (startTransfer / interrupt)
+  uint32_t dmaTransfers_;
+  uint32_t dmaBytes_;
+  uint32_t dmaBusyUs_;
+  uint32_t dmaStartUs_;  // us_ticker time the running transfer started
+
+  // Returns the number of bytes that can currently be queued
+  size_t queueFree(uint8_t* queueStart, uint8_t* queueEnd);
+  // Applies the overflow policy when len bytes do not fit, updating data and len to what
+  // should be queued. Returns false if nothing should be queued.
+  bool handleOverflow(uint8_t*& data, size_t& len);
+  // Discards queued bytes not already handed to the DMA to make room for len, in constant time.
+  void dropOldest(size_t len);
+  void updateHighWaterMark();
+
+  uint8_t dmaChannel_;  // DMA channel claimed for transmit
+
+  DmaController::Request dmaRequest();
   void startTransfer();
   void irqTransferDone();
 };
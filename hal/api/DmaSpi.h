@@ -0,0 +1,45 @@
+#ifndef _DMA_SPI_H_
+#define _DMA_SPI_H_
+
+#include "mbed.h"
+
+#include "DmaController.h"
+#include "SpiBus.h"
+
+/**
+ * SPI master with DMA transactions: a SpiBus whose queued transactions run on the SPI's RX and
+ * TX DMA channels, so devices sharing the bus don't block the CPU.
+ * Frames must be 8 bits (the default format), and transactions at most kDmaMaxTransfers bytes.
+ * The blocking SPI::write must not be used while transactions are queued.
+ */
+class DmaSpi : public SPI, public SpiBus {
+public:
+  DmaSpi(PinName mosi, PinName miso, PinName sclk);
+
+  void submit(SpiTransaction& transaction);
+
+  /**
+   * Returns whether no transactions are queued or running.
+   */
+  bool idle() const {
+    return head_ == NULL;
+  }
+
+protected:
+  // Starts the transaction at the head of the queue
+  void startTransaction();
+
+  // RX DMA completion, the last byte has been clocked in
+  void irqTransactionDone();
+
+  uint8_t rxChannel_;
+  uint8_t txChannel_;
+
+  SpiTransaction* head_;  // running transaction, followed by queued ones
+  SpiTransaction* tail_;
+
+  uint8_t dummyRx_;  // discarded received bytes
+  static const uint8_t kDummyTx = 0;  // sent bytes when there is no tx buffer
+};
+
+#endif
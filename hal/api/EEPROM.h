@@ -12,6 +12,9 @@ namespace EEPROM {
     
     const IAP iap_entry = (IAP) IAP_LOCATION;
 
+    const uint32_t SIZE = 4032;  // usable bytes, the top 64 bytes of the 4 KB are reserved
+    const uint32_t PAGE_BYTES = 64;  // bytes per EEPROM page, the unit of programming
+
     void init();
 
     void write(uint32_t address, uint8_t *data, uint32_t bytes);
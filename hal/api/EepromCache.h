@@ -0,0 +1,68 @@
+#ifndef _EEPROM_CACHE_H_
+#define _EEPROM_CACHE_H_
+
+#include "mbed.h"
+
+#include "EEPROM.h"
+
+/**
+ * Write-back RAM shadow of the whole EEPROM, with per-page dirty tracking.
+ *
+ * Writes only update the shadow, marking pages dirty if their contents actually changed. flush()
+ * then programs the dirty pages, merging runs of consecutive dirty pages into a single IAP
+ * command, so several small field updates cost one page program instead of one each.
+ * Reads are served from the shadow.
+ *
+ * Data not yet flushed is lost on reset, so flush after anything that must persist, or
+ * periodically (for example, from a TimerTicker in the main loop).
+ */
+class EepromCache {
+public:
+  static const uint32_t kNumPages = EEPROM::SIZE / EEPROM::PAGE_BYTES;
+
+  EepromCache();
+
+  /**
+   * Fills the shadow from the EEPROM with a single bulk read, discarding unflushed writes.
+   * Call once at boot, after EEPROM::init, before any other operation.
+   */
+  void load();
+
+  void read(uint32_t address, uint8_t* data, uint32_t bytes) const;
+  void write(uint32_t address, const uint8_t* data, uint32_t bytes);
+
+  /**
+   * Programs all dirty pages.
+   * Returns the number of IAP commands issued.
+   */
+  size_t flush();
+
+  /**
+   * Programs the first run of consecutive dirty pages only, bounding the time spent in IAP.
+   * Returns whether anything was written.
+   */
+  bool flushRun();
+
+  bool dirty() const {
+    return dirtyPages_ != 0;
+  }
+
+  /**
+   * Returns the total number of IAP write commands and pages programmed since construction.
+   */
+  uint32_t iapCommands() const {
+    return iapCommands_;
+  }
+  uint32_t pagesWritten() const {
+    return pagesWritten_;
+  }
+
+protected:
+  uint8_t shadow_[EEPROM::SIZE];
+  uint64_t dirtyPages_;  // bit n set when page n differs from the EEPROM
+
+  uint32_t iapCommands_;
+  uint32_t pagesWritten_;
+};
+
+#endif
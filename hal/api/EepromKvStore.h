@@ -0,0 +1,365 @@
+#ifndef _EEPROM_KV_STORE_H_
+#define _EEPROM_KV_STORE_H_
+
+#include "mbed.h"
+#include <algorithm>
+
+#include "EEPROM.h"
+#include "crc.h"
+
+/**
+ * Log-structured key-value store on the EEPROM, spreading writes over the whole region instead
+ * of rewriting values in place.
+ *
+ * The region is split into two banks. Each write appends a record (key, length, sequence
+ * number, CRC32) to the active bank, and a RAM index maps each key to its latest record, so
+ * lookups don't scan. When the active bank fills, compaction copies the live records into the
+ * other bank, one key per service() call, while new writes go straight to the new bank.
+ *
+ * Power-fail safety: a record only counts if its CRC matches, so torn writes are ignored. The
+ * new bank's header is written before any records are copied, and the old bank's header is only
+ * erased once everything live was copied. If both banks are valid at boot, both are scanned and
+ * the highest sequence number wins for each key, and the interrupted compaction resumes.
+ *
+ * The live data (latest record of every key) must fit well within one bank.
+ *
+ * @tparam MaxKeys number of keys, which are 0 through MaxKeys - 1
+ * @tparam MaxValueLength maximum value length, sizing the record buffer on the stack
+ */
+template <size_t MaxKeys, size_t MaxValueLength = 64>
+class EepromKvStore {
+  static_assert(MaxKeys <= 256, "keys are 8-bit");
+  static_assert(MaxValueLength < 255, "value length 255 is reserved for deleted records");
+
+public:
+  struct Stats {
+    uint32_t userBytes;  // value bytes written by callers
+    uint32_t eepromBytes;  // bytes written to the EEPROM, including headers and compaction copies
+    uint32_t compactions;  // number of compactions started
+  };
+
+  /**
+   * @param base first EEPROM address of the region used by the store
+   * @param length size of the region, in bytes
+   */
+  EepromKvStore(uint32_t base = 0, uint32_t length = EEPROM::SIZE) :
+      base_(base), bankSize_(length / 2),
+      activeBank_(0), generation_(0), writeAddress_(0), nextSequence_(0),
+      compacting_(false), compactKey_(0), stats_({0, 0, 0}) {
+  }
+
+  /**
+   * Scans the EEPROM to rebuild the index, formatting the region if it holds no valid bank.
+   * Call this once at boot (after EEPROM::init), before any other operation.
+   */
+  void init() {
+    for (size_t i=0; i<MaxKeys; i++) {
+      index_[i].address = kNoRecord;
+    }
+    nextSequence_ = 0;
+    compacting_ = false;
+
+    uint16_t generations[2];
+    bool valid[2];
+    for (uint8_t i=0; i<2; i++) {
+      valid[i] = readBankHeader(i, generations[i]);
+    }
+
+    if (valid[0] && valid[1]) {  // interrupted compaction, merge both and finish it later
+      activeBank_ = (int16_t)(generations[1] - generations[0]) > 0 ? 1 : 0;
+      scanBank(1 - activeBank_, generations[1 - activeBank_]);
+      generation_ = generations[activeBank_];
+      writeAddress_ = scanBank(activeBank_, generation_);
+      compacting_ = true;
+      compactKey_ = 0;
+    } else if (valid[0] || valid[1]) {
+      activeBank_ = valid[0] ? 0 : 1;
+      generation_ = generations[activeBank_];
+      writeAddress_ = scanBank(activeBank_, generation_);
+    } else {  // blank or corrupt region, start over
+      activeBank_ = 0;
+      generation_ = 1;
+      writeBankHeader(activeBank_, generation_);
+      writeAddress_ = bankStart(activeBank_) + sizeof(BankHeader);
+    }
+  }
+
+  /**
+   * Reads the value of a key, copying at most maxLength bytes.
+   *
+   * @returns the full length of the value, or -1 if the key has no value
+   */
+  int read(uint8_t key, uint8_t* data, size_t maxLength) {
+    if (key >= MaxKeys || index_[key].address == kNoRecord || index_[key].length == kDeleted) {
+      return -1;
+    }
+    size_t length = std::min((size_t)index_[key].length, maxLength);
+    EEPROM::read(index_[key].address + sizeof(RecordHeader), data, length);
+    return index_[key].length;
+  }
+
+  /**
+   * Writes the value of a key, a single EEPROM write unless the store has to compact first.
+   * Returns false if the key or length is out of range, or the store is full.
+   */
+  bool write(uint8_t key, const uint8_t* data, size_t length) {
+    if (key >= MaxKeys || length > MaxValueLength) {
+      return false;
+    }
+    if (!appendRecordOrCompact(key, data, length)) {
+      return false;
+    }
+    stats_.userBytes += length;
+    return true;
+  }
+
+  /**
+   * Deletes the value of a key.
+   */
+  bool remove(uint8_t key) {
+    if (key >= MaxKeys) {
+      return false;
+    }
+    if (index_[key].address == kNoRecord || index_[key].length == kDeleted) {
+      return true;
+    }
+    return appendRecordOrCompact(key, NULL, kDeleted);
+  }
+
+  /**
+   * Background maintenance, call this regularly from idle time.
+   * Starts a compaction once the active bank is three-quarters full and compaction would free
+   * a meaningful amount of space, and copies one key per call while compacting.
+   *
+   * @returns true if any EEPROM work was done
+   */
+  bool service() {
+    if (compacting_) {
+      compactStep();
+      return true;
+    }
+    uint32_t used = writeAddress_ - bankStart(activeBank_);
+    if (used >= bankSize_ * 3 / 4 && used - liveBytes() >= bankSize_ / 4) {
+      startCompaction();
+      return true;
+    }
+    return false;
+  }
+
+  Stats readStats() const {
+    return stats_;
+  }
+
+protected:
+  struct BankHeader {
+    uint32_t magic;
+    uint16_t generation;  // incremented on each compaction, newer bank wins
+    uint16_t reserved;
+    uint32_t crc;  // over the preceding fields
+  };
+
+  struct RecordHeader {
+    uint16_t generation;  // bank generation, so stale records from earlier use of a bank are ignored
+    uint8_t key;
+    uint8_t length;  // kDeleted for deletions
+    uint32_t sequence;  // highest sequence wins when merging banks
+  };
+  // followed by length bytes of data and a CRC32 over the header and data
+
+  struct IndexEntry {
+    uint16_t address;  // EEPROM address of the latest record, or kNoRecord
+    uint8_t length;
+    uint32_t sequence;
+  };
+
+  static const uint32_t kMagic = 0x4b565331;  // "KVS1"
+  static const uint8_t kDeleted = 0xff;
+  static const uint16_t kNoRecord = 0xffff;
+  static const size_t kCrcLength = sizeof(uint32_t);
+
+  uint32_t bankStart(uint8_t bank) const {
+    return base_ + bank * bankSize_;
+  }
+
+  bool inBank(uint32_t address, uint8_t bank) const {
+    return address >= bankStart(bank) && address < bankStart(bank) + bankSize_;
+  }
+
+  static size_t recordLength(uint8_t length) {
+    return sizeof(RecordHeader) + (length == kDeleted ? 0 : length) + kCrcLength;
+  }
+
+  bool readBankHeader(uint8_t bank, uint16_t& generation) {
+    BankHeader header;
+    EEPROM::read(bankStart(bank), (uint8_t*)&header, sizeof(header));
+    generation = header.generation;
+    return header.magic == kMagic
+        && header.crc == CRC32::compute((uint8_t*)&header, offsetof(BankHeader, crc));
+  }
+
+  void writeBankHeader(uint8_t bank, uint16_t generation) {
+    BankHeader header;
+    header.magic = kMagic;
+    header.generation = generation;
+    header.reserved = 0;
+    header.crc = CRC32::compute((uint8_t*)&header, offsetof(BankHeader, crc));
+    EEPROM::write(bankStart(bank), (uint8_t*)&header, sizeof(header));
+    stats_.eepromBytes += sizeof(header);
+  }
+
+  void eraseBankHeader(uint8_t bank) {
+    BankHeader header;
+    memset(&header, 0, sizeof(header));
+    EEPROM::write(bankStart(bank), (uint8_t*)&header, sizeof(header));
+    stats_.eepromBytes += sizeof(header);
+  }
+
+  // Adds the valid records of a bank to the index, returning the address past the last one.
+  uint32_t scanBank(uint8_t bank, uint16_t generation) {
+    uint8_t buffer[sizeof(RecordHeader) + MaxValueLength + kCrcLength];
+    RecordHeader& header = *(RecordHeader*)buffer;
+    uint32_t address = bankStart(bank) + sizeof(BankHeader);
+    uint32_t end = bankStart(bank) + bankSize_;
+
+    while (address + recordLength(0) <= end) {
+      EEPROM::read(address, buffer, sizeof(RecordHeader));
+      if (header.generation != generation || header.key >= MaxKeys
+          || (header.length > MaxValueLength && header.length != kDeleted)) {
+        break;
+      }
+      size_t length = recordLength(header.length);
+      if (address + length > end) {
+        break;
+      }
+      size_t dataLength = length - sizeof(RecordHeader) - kCrcLength;
+      EEPROM::read(address + sizeof(RecordHeader), buffer + sizeof(RecordHeader),
+          dataLength + kCrcLength);
+      uint32_t crc;
+      memcpy(&crc, buffer + sizeof(RecordHeader) + dataLength, kCrcLength);
+      if (crc != CRC32::compute(buffer, sizeof(RecordHeader) + dataLength)) {
+        break;  // torn write, nothing valid follows
+      }
+
+      // Ties are compaction copies, keep the later scanned (newer bank) copy so it isn't copied again
+      IndexEntry& entry = index_[header.key];
+      if (entry.address == kNoRecord || (int32_t)(header.sequence - entry.sequence) >= 0) {
+        entry.address = address;
+        entry.length = header.length;
+        entry.sequence = header.sequence;
+      }
+      if ((int32_t)(header.sequence - nextSequence_) >= 0) {
+        nextSequence_ = header.sequence + 1;
+      }
+      address += length;
+    }
+    return address;
+  }
+
+  // Appends a record to the active bank, returning false if it doesn't fit.
+  bool appendRecord(uint8_t key, const uint8_t* data, uint8_t length, uint32_t sequence) {
+    size_t totalLength = recordLength(length);
+    if (writeAddress_ + totalLength > bankStart(activeBank_) + bankSize_) {
+      return false;
+    }
+    size_t dataLength = totalLength - sizeof(RecordHeader) - kCrcLength;
+
+    uint8_t buffer[sizeof(RecordHeader) + MaxValueLength + kCrcLength];
+    RecordHeader& header = *(RecordHeader*)buffer;
+    header.generation = generation_;
+    header.key = key;
+    header.length = length;
+    header.sequence = sequence;
+    if (dataLength > 0) {
+      memcpy(buffer + sizeof(RecordHeader), data, dataLength);
+    }
+    uint32_t crc = CRC32::compute(buffer, sizeof(RecordHeader) + dataLength);
+    memcpy(buffer + sizeof(RecordHeader) + dataLength, &crc, kCrcLength);
+    EEPROM::write(writeAddress_, buffer, totalLength);
+
+    index_[key].address = writeAddress_;
+    index_[key].length = length;
+    index_[key].sequence = sequence;
+    writeAddress_ += totalLength;
+    stats_.eepromBytes += totalLength;
+    return true;
+  }
+
+  bool appendRecordOrCompact(uint8_t key, const uint8_t* data, uint8_t length) {
+    if (!appendRecord(key, data, length, nextSequence_)) {
+      // Out of space: finish any running compaction, then compact the result
+      while (compacting_) {
+        compactStep();
+      }
+      startCompaction();
+      while (compacting_) {
+        compactStep();
+      }
+      if (!appendRecord(key, data, length, nextSequence_)) {
+        return false;
+      }
+    }
+    nextSequence_++;
+    return true;
+  }
+
+  uint32_t liveBytes() const {
+    uint32_t bytes = 0;
+    for (size_t i=0; i<MaxKeys; i++) {
+      if (index_[i].address != kNoRecord && index_[i].length != kDeleted) {
+        bytes += recordLength(index_[i].length);
+      }
+    }
+    return bytes;
+  }
+
+  void startCompaction() {
+    uint8_t target = 1 - activeBank_;
+    generation_++;
+    writeBankHeader(target, generation_);  // from here on, boot merges both banks
+    activeBank_ = target;
+    writeAddress_ = bankStart(target) + sizeof(BankHeader);
+    compacting_ = true;
+    compactKey_ = 0;
+    stats_.compactions++;
+  }
+
+  // Copies the next live key out of the old bank, or retires the old bank when none are left.
+  void compactStep() {
+    uint8_t oldBank = 1 - activeBank_;
+    while (compactKey_ < MaxKeys) {
+      uint8_t key = compactKey_++;
+      IndexEntry& entry = index_[key];
+      if (entry.address == kNoRecord || !inBank(entry.address, oldBank)) {
+        continue;
+      }
+      if (entry.length == kDeleted) {  // deletions disappear with the old bank
+        entry.address = kNoRecord;
+        continue;
+      }
+      uint8_t data[MaxValueLength];
+      EEPROM::read(entry.address + sizeof(RecordHeader), data, entry.length);
+      if (!appendRecord(key, data, entry.length, entry.sequence)) {
+        error("EEPROM store live data exceeds bank size");
+      }
+      return;
+    }
+    eraseBankHeader(oldBank);
+    compacting_ = false;
+  }
+
+  const uint32_t base_;
+  const uint32_t bankSize_;
+
+  IndexEntry index_[MaxKeys];
+  uint8_t activeBank_;
+  uint16_t generation_;  // generation of the active bank
+  uint32_t writeAddress_;  // next free address in the active bank
+  uint32_t nextSequence_;
+
+  bool compacting_;  // whether the other bank still holds live records
+  size_t compactKey_;  // next key to check for copying during compaction
+
+  Stats stats_;
+};
+
+#endif
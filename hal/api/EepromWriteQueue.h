@@ -0,0 +1,148 @@
+#ifndef _EEPROM_WRITE_QUEUE_H_
+#define _EEPROM_WRITE_QUEUE_H_
+
+#include "mbed.h"
+#include <algorithm>
+
+#include "EEPROM.h"
+
+/**
+ * Asynchronous EEPROM writes, executed one page program at a time when the main loop has time
+ * to spare.
+ *
+ * Each EEPROM::write blocks for the whole IAP page program, so instead of writing directly,
+ * callers enqueue writes and the main loop calls service() with the slack before its next
+ * deadline. A page program only runs if it is expected to fit. The expected duration follows
+ * the slowest recent page programs and decays back towards faster ones. A single slow
+ * measurement (such as one stretched by an interrupt) only raises it by a quarter, so one
+ * outlier can't starve the queue, but a second slow one in a row is taken in full.
+ *
+ * Requests are split at page boundaries and run in order. Not interrupt-safe: enqueue and
+ * service from the main loop only.
+ *
+ * @tparam NumRequests maximum number of queued requests
+ * @tparam MaxCopyBytes maximum length of a request that is copied into the queue
+ */
+template <size_t NumRequests, size_t MaxCopyBytes = EEPROM::PAGE_BYTES>
+class EepromWriteQueue {
+public:
+  enum Ownership {
+    kCopy,  // data is copied into the queue, the caller's buffer may be reused immediately
+    kZeroCopy,  // the queue reads the caller's buffer, which must stay unchanged until completion
+  };
+
+  /**
+   * @param pageProgram_us initial estimate of the time a page program blocks for
+   */
+  EepromWriteQueue(uint32_t pageProgram_us = 3000) :
+      head_(0), count_(0), pageProgramUs_(pageProgram_us), lastProgramSlow_(false) {
+  }
+
+  /**
+   * Queues a write, with a callback fired from service() once all of it was written.
+   * Returns false if the queue is full, the write is empty or out of range, or a copied write is
+   * longer than MaxCopyBytes.
+   */
+  bool enqueue(uint32_t address, const uint8_t* data, size_t length,
+      Ownership ownership = kCopy, Callback<void()> callback = Callback<void()>()) {
+    if (count_ >= NumRequests || length == 0 || (ownership == kCopy && length > MaxCopyBytes)
+        || address + length > EEPROM::SIZE) {
+      return false;
+    }
+    Request& request = requests_[(head_ + count_) % NumRequests];
+    request.address = address;
+    request.length = length;
+    request.written = 0;
+    if (ownership == kCopy) {
+      memcpy(request.copy, data, length);
+      request.data = request.copy;
+    } else {
+      request.data = data;
+    }
+    request.callback = callback;
+    count_++;
+    return true;
+  }
+
+  /**
+   * Runs one page program if one is pending and the estimated page program time fits within
+   * the slack. Call this from the main loop when idle.
+   *
+   * @param slack_us time available before the next deadline
+   * @returns true if a page was programmed
+   */
+  bool service(uint32_t slack_us) {
+    if (count_ == 0 || slack_us < pageProgramUs_) {
+      return false;
+    }
+    Request& request = requests_[head_];
+    uint32_t address = request.address + request.written;
+    uint32_t pageRemaining = EEPROM::PAGE_BYTES - address % EEPROM::PAGE_BYTES;
+    uint32_t chunk = std::min(request.length - request.written, pageRemaining);
+
+    uint32_t startUs = us_ticker_read();
+    EEPROM::write(address, const_cast<uint8_t*>(request.data + request.written), chunk);
+    uint32_t elapsedUs = us_ticker_read() - startUs;
+    if (elapsedUs > pageProgramUs_) {
+      if (lastProgramSlow_) {  // confirmed, take the new peak
+        pageProgramUs_ = elapsedUs;
+      } else {  // possibly an outlier
+        pageProgramUs_ += std::min(elapsedUs - pageProgramUs_, pageProgramUs_ / 4);
+      }
+      lastProgramSlow_ = true;
+    } else {
+      pageProgramUs_ -= (pageProgramUs_ - elapsedUs) / 8;
+      lastProgramSlow_ = false;
+    }
+
+    request.written += chunk;
+    if (request.written >= request.length) {
+      Callback<void()> callback = request.callback;
+      head_ = (head_ + 1) % NumRequests;
+      count_--;
+      if (callback) {
+        callback();
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Blocks until every queued write has completed.
+   */
+  void sync() {
+    while (count_ > 0) {
+      service(UINT32_MAX);
+    }
+  }
+
+  bool idle() const {
+    return count_ == 0;
+  }
+
+  /**
+   * Returns the slack currently required to run a page program, in us.
+   */
+  uint32_t pageProgramEstimateUs() const {
+    return pageProgramUs_;
+  }
+
+protected:
+  struct Request {
+    uint32_t address;
+    const uint8_t* data;  // points to copy for kCopy requests
+    uint32_t length;
+    uint32_t written;  // bytes already programmed
+    Callback<void()> callback;
+    uint8_t copy[MaxCopyBytes];
+  };
+
+  Request requests_[NumRequests];
+  size_t head_;  // index of the oldest request
+  size_t count_;
+
+  uint32_t pageProgramUs_;  // decaying peak of the page program time
+  bool lastProgramSlow_;  // whether the last page program took longer than the estimate
+};
+
+#endif
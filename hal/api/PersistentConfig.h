@@ -0,0 +1,123 @@
+#ifndef _PERSISTENT_CONFIG_H_
+#define _PERSISTENT_CONFIG_H_
+
+#include "mbed.h"
+
+#include "EEPROM.h"
+#include "crc.h"
+
+/**
+ * A typed configuration block in the EEPROM, stored as two copies each with a version counter
+ * and CRC32, so an interrupted save never loses the previous configuration.
+ *
+ * Each copy starts on its own EEPROM page, since the EEPROM is programmed a page at a time and a
+ * reset while programming one copy must not damage the other.
+ *
+ * load() fetches both copies with a single EEPROM read (through a stack buffer of about
+ * kFootprint bytes) and picks the newest valid one, which is then accessed in place through get(). save() writes the older copy with the next version,
+ * and the newer version becomes active once written; a torn write fails its CRC and the previous
+ * copy wins at the next boot.
+ *
+ * @tparam T configuration type, must be trivially copyable and keep the same layout between
+ *     firmware versions (or change the address when it doesn't)
+ */
+template <typename T>
+class PersistentConfig {
+protected:
+  struct Slot {
+    uint32_t version;
+    T data;
+    uint32_t crc;  // over all preceding bytes
+  };
+
+  // Distance between the copies, rounded up to whole pages
+  static const uint32_t kSlotStride =
+      (sizeof(Slot) + EEPROM::PAGE_BYTES - 1) / EEPROM::PAGE_BYTES * EEPROM::PAGE_BYTES;
+
+public:
+  static const uint32_t kFootprint = 2 * kSlotStride;  // EEPROM bytes used
+
+  /**
+   * @param address EEPROM address of the first copy, page aligned, with kFootprint bytes reserved
+   */
+  PersistentConfig(uint32_t address) :
+      address_(address), active_(0), valid_(false) {
+    if (address % EEPROM::PAGE_BYTES != 0) {
+      error("PersistentConfig address must be page aligned");
+    }
+  }
+
+  /**
+   * Loads the newest valid copy. Call this once at boot, after EEPROM::init.
+   * If neither copy is valid, defaults becomes the active configuration (without being saved).
+   *
+   * @returns whether a valid copy was found
+   */
+  bool load(const T& defaults) {
+    // One bulk read covering both copies and the padding between them
+    uint8_t buffer[kSlotStride + sizeof(Slot)];
+    EEPROM::read(address_, buffer, sizeof(buffer));
+    memcpy(&slots_[0], buffer, sizeof(Slot));
+    memcpy(&slots_[1], buffer + kSlotStride, sizeof(Slot));
+    bool valid0 = slotValid(slots_[0]);
+    bool valid1 = slotValid(slots_[1]);
+    if (valid0 && valid1) {
+      active_ = (int32_t)(slots_[1].version - slots_[0].version) > 0 ? 1 : 0;
+    } else if (valid0 || valid1) {
+      active_ = valid0 ? 0 : 1;
+    } else {
+      active_ = 0;
+      slots_[0].version = 0;
+      slots_[0].data = defaults;
+    }
+    valid_ = valid0 || valid1;
+    return valid_;
+  }
+
+  /**
+   * Returns the active configuration, without copying.
+   * The reference is invalidated by the second save() after it was taken.
+   */
+  const T& get() const {
+    return slots_[active_].data;
+  }
+
+  /**
+   * Writes a new configuration to the inactive copy, then makes it active.
+   */
+  void save(const T& value) {
+    uint8_t target = 1 - active_;
+    Slot& slot = slots_[target];
+    memset(&slot, 0, sizeof(slot));  // deterministic padding, since it is covered by the CRC
+    slot.version = slots_[active_].version + 1;
+    slot.data = value;
+    slot.crc = CRC32::compute((uint8_t*)&slot, offsetof(Slot, crc));
+    EEPROM::write(address_ + target * kSlotStride, (uint8_t*)&slot, sizeof(slot));
+    active_ = target;
+    valid_ = true;
+  }
+
+  /**
+   * Returns whether the active configuration came from (or was saved to) the EEPROM, rather
+   * than being the defaults.
+   */
+  bool valid() const {
+    return valid_;
+  }
+
+  uint32_t version() const {
+    return slots_[active_].version;
+  }
+
+protected:
+  static bool slotValid(Slot& slot) {
+    return slot.crc == CRC32::compute((uint8_t*)&slot, offsetof(Slot, crc));
+  }
+
+  const uint32_t address_;
+  Slot slots_[2];  // RAM image of both EEPROM copies
+  uint8_t active_;
+  bool valid_;
+};
+
+#endif
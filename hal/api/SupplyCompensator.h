@@ -0,0 +1,81 @@
+#ifndef _SUPPLY_COMPENSATOR_H_
+#define _SUPPLY_COMPENSATOR_H_
+
+#include "mbed.h"
+
+#include "AnalogPeripherals.h"
+#include "LongTimer.h"
+
+/**
+ * Ratiometric supply compensation for internal ADC readings.
+ * ADC readings are relative to the analog supply, so they drift with the 3.3v rail. This
+ * periodically samples the internal bandgap (a fixed voltage) to keep a filtered estimate of the
+ * actual supply voltage, and rescales readings to what they would be at the nominal supply.
+ *
+ * Correcting a reading is a single integer multiply and shift, the bandgap is only sampled in
+ * update().
+ */
+class SupplyCompensator {
+public:
+  /**
+   * @param bandgap bandgap reference to sample
+   * @param timebase timer for the sampling period
+   * @param period_us time between bandgap samples
+   * @param bandgap_mV bandgap voltage, ideally calibrated per board against a known supply
+   * @param nominalVdd_mV supply voltage that corrected readings are scaled to
+   */
+  SupplyCompensator(BandgapReference& bandgap, Timer& timebase, uint32_t period_us,
+      uint16_t bandgap_mV = 905, uint16_t nominalVdd_mV = 3300);
+
+  /**
+   * Samples the bandgap if the period has elapsed. Call this regularly.
+   * The first call always samples.
+   * Returns true if a sample was taken.
+   */
+  bool update();
+
+  /**
+   * Adds a bandgap reading (from read_u16) to the supply estimate, for callers that sample
+   * the bandgap themselves.
+   */
+  void addBandgapSample(uint16_t bandgapReading);
+
+  /**
+   * Returns a 16-bit ADC reading rescaled to the nominal supply, saturating at full scale.
+   * Readings pass through uncorrected until the first bandgap sample.
+   */
+  uint16_t correct(uint16_t reading) const {
+    uint32_t corrected = ((uint32_t)reading * gainQ15_) >> 15;
+    return corrected > 0xffff ? 0xffff : corrected;
+  }
+
+  /**
+   * Returns the voltage of a 16-bit ADC reading, in mV, using the estimated supply.
+   */
+  uint16_t toMillivolts(uint16_t reading) const {
+    return ((uint32_t)reading * vdd_mV_) >> 16;
+  }
+
+  /**
+   * Returns the estimated supply voltage, in mV.
+   */
+  uint16_t vddMillivolts() const {
+    return vdd_mV_;
+  }
+
+protected:
+  static const uint8_t kFilterShift = 3;  // IIR filter weight of 1/8 per new sample
+  static const uint8_t kBandgapFractionBits = 4;  // fixed-point fraction of the filtered reading
+
+  BandgapReference& bandgap_;
+  TimerTicker ticker_;
+  const uint16_t bandgap_mV_;
+  const uint16_t nominalVdd_mV_;
+
+  bool sampled_;  // whether any bandgap sample was taken
+  uint32_t filteredBandgap_;  // filtered bandgap reading, with kBandgapFractionBits fraction
+  uint32_t gainQ15_;  // actual over nominal supply, Q15 fixed point, limited below 2.0
+  uint16_t vdd_mV_;  // estimated supply voltage
+};
+
+#endif
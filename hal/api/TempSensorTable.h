@@ -0,0 +1,66 @@
+#ifndef _TEMP_SENSOR_TABLE_H_
+#define _TEMP_SENSOR_TABLE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Compile-time conversion table from internal temperature sensor readings to temperature.
+ *
+ * The table is generated from tempSensorReferenceCentidegrees, the datasheet sensor curve, at
+ * evenly spaced 16-bit ADC codes, and conversions linearly interpolate between entries with
+ * integer math only. A nonlinear curve fit can be dropped into the reference function without
+ * changing the runtime cost.
+ */
+
+const int32_t kTempSensorZero_uV = 577300;  // sensor output at 0C
+const int32_t kTempSensorSlope_nVPerC = -2290000;  // sensor output change per C
+const int32_t kTempSensorVdd_uV = 3300000;  // supply the table is computed at
+const uint8_t kTempSensorTableShift = 10;  // ADC code bits between table entries
+const size_t kTempSensorTableSize = (1 << (16 - kTempSensorTableShift)) + 1;
+
+/**
+ * Reference conversion from a 16-bit ADC code to hundredths of a degree C, saturated to int16_t.
+ * Far too slow for runtime use, used to generate the table and check accuracy against.
+ */
+constexpr int32_t tempSensorSaturate(int64_t centidegrees) {
+  return centidegrees > INT16_MAX ? INT16_MAX
+      : centidegrees < INT16_MIN ? INT16_MIN
+      : centidegrees;
+}
+
+constexpr int32_t tempSensorReferenceCentidegrees(uint32_t code) {
+  // (output - zero) / slope, where output = code * Vdd / 2^16, scaled to nV and centidegrees
+  return tempSensorSaturate(
+      ((int64_t)code * kTempSensorVdd_uV * 1000 / 65536 - (int64_t)kTempSensorZero_uV * 1000)
+      * 100 / kTempSensorSlope_nVPerC);
+}
+
+template <size_t... I> struct TempSensorIndices {};
+template <size_t N, size_t... I> struct MakeTempSensorIndices :
+    MakeTempSensorIndices<N - 1, N - 1, I...> {};
+template <size_t... I> struct MakeTempSensorIndices<0, I...> {
+  typedef TempSensorIndices<I...> type;
+};
+
+template <typename Indices> struct TempSensorTableValues;
+template <size_t... I> struct TempSensorTableValues<TempSensorIndices<I...>> {
+  static constexpr int16_t values[] = {
+      (int16_t)tempSensorReferenceCentidegrees(I << kTempSensorTableShift)... };
+};
+template <size_t... I>
+constexpr int16_t TempSensorTableValues<TempSensorIndices<I...>>::values[];
+
+typedef TempSensorTableValues<MakeTempSensorIndices<kTempSensorTableSize>::type> TempSensorTable;
+
+/**
+ * Converts a 16-bit ADC code (as from read_u16) to hundredths of a degree C.
+ * A table lookup, multiply and shift.
+ */
+inline int16_t tempSensorCentidegrees(uint16_t code) {
+  const int16_t* entry = &TempSensorTable::values[code >> kTempSensorTableShift];
+  int32_t fraction = code & ((1 << kTempSensorTableShift) - 1);
+  return entry[0] + (((entry[1] - entry[0]) * fraction) >> kTempSensorTableShift);
+}
+
+#endif
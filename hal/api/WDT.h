@@ -22,6 +22,17 @@ class WDT {
          */
         void setTimeout(uint32_t timeout_us);
 
+        /**
+         * Set the warning interrupt to fire warning_us before the timeout, and enable it in the NVIC. The handler must be installed with NVIC_SetVector(WDT_IRQn, ...) and clear the flag with clearWarning().
+         * @param warning_us Time (in us) before the timeout, at most about 8ms (1023 WDT ticks), longer values are clamped. Same oscillator accuracy caveats as the timeout.
+         */
+        void setWarning(uint32_t warning_us);
+
+        /**
+         * Clear the warning interrupt flag, call this from the warning interrupt handler
+         */
+        void clearWarning();
+
         /**
          * Enable the Watchdog Timer. Once the WDT is enabled it cannot be disabled!
          */
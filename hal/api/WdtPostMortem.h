@@ -0,0 +1,73 @@
+#ifndef _WDT_POST_MORTEM_H_
+#define _WDT_POST_MORTEM_H_
+
+#include <stdint.h>
+
+#include "WDT.h"
+
+/**
+ * Post-mortem capture on a watchdog timeout. The WWDT warning interrupt snapshots the recent
+ * main loop timestamps, the running task, the interrupted PC/LR and some application counters
+ * into a CRC-protected record in no-init RAM, which survives the following watchdog reset and
+ * can be read back on the next boot.
+ *
+ * The record lives in the .noinit section, which the linker script must place in RAM without
+ * zeroing it at startup.
+ */
+namespace WdtPostMortem {
+  const uint8_t kNumLoopMarks = 8;
+  const uint8_t kNumCounters = 4;
+  const uint8_t kNoTask = 0xff;
+
+  struct Record {
+    uint32_t magic;
+    uint32_t pc;  // stacked return address of the interrupted code
+    uint32_t lr;  // stacked link register of the interrupted code
+    uint32_t capture_us;  // us_ticker time of the warning interrupt
+    uint32_t loopMarks_us[kNumLoopMarks];  // us_ticker times of the latest loopMark calls, oldest first
+    uint32_t counters[kNumCounters];
+    uint8_t task;  // last setTask value, or kNoTask
+    uint8_t reserved[3];
+    uint32_t crc;  // over all preceding bytes
+  };
+
+  /**
+   * Checks for a record left by a watchdog reset, then installs the warning interrupt handler.
+   * Call once at boot, before the WDT is enabled.
+   *
+   * @param warning_us time before the watchdog timeout to capture the record, see WDT::setWarning
+   */
+  void install(WDT& wdt, uint32_t warning_us);
+
+  /**
+   * Records a main loop timestamp, call once per loop iteration.
+   */
+  void loopMark();
+
+  /**
+   * Records the currently executing task, or kNoTask.
+   */
+  void setTask(uint8_t task);
+
+  /**
+   * Sets an application counter that is saved into the record.
+   */
+  void setCounter(uint8_t index, uint32_t value);
+
+  /**
+   * Returns whether a valid record from a watchdog reset was found by install().
+   */
+  bool available();
+
+  /**
+   * Returns the record found by install(), only meaningful if available().
+   */
+  const Record& record();
+
+  /**
+   * Discards the record, so it is not reported again after a non-watchdog reset.
+   */
+  void clear();
+}
+
+#endif
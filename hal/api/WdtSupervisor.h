@@ -0,0 +1,200 @@
+#ifndef _WDT_SUPERVISOR_H_
+#define _WDT_SUPERVISOR_H_
+
+#include <atomic>
+
+#include "mbed.h"
+
+#include "WDT.h"
+#include "StatisticalCounter.h"
+#include "Histogram.h"
+
+/**
+ * Watchdog supervisor for multiple tasks, each with its own check-in budget. The hardware
+ * watchdog is only fed when every registered task has checked in within its budget, and no
+ * interval since the previous service() overran it, so a single stuck task (or a starved
+ * interrupt) still resets the system.
+ *
+ * checkIn() is lock-free and safe to call from interrupts. service() must be called from a
+ * single thread, typically the main loop, more often than the WDT timeout.
+ *
+ * Check-in intervals are tracked per task to tune budgets: each service() call where a task
+ * checked in contributes one sample, the longest interval seen since the previous call.
+ *
+ * @tparam MaxTasks maximum number of registered tasks
+ */
+template <size_t MaxTasks>
+class WdtSupervisor {
+public:
+  static const int8_t kNoTask = -1;
+  static const size_t kNumIntervalDividers = 7;
+  // interval histogram bucket limits, in percent of the task budget
+  static const uint16_t kIntervalDividers[kNumIntervalDividers];
+
+  typedef Histogram<kNumIntervalDividers, uint16_t, uint32_t> IntervalHistogram;
+
+  struct TaskStats {
+    StatisticalCounter<uint32_t, uint64_t>::StatisticalResult interval_us;
+    uint32_t checkIns;
+    uint32_t misses;  // service() calls where this task was late
+  };
+
+  /**
+   * @param wdt hardware watchdog, which should already be enabled
+   * @param timebase microsecond timer used to timestamp check-ins, must be running
+   */
+  WdtSupervisor(WDT& wdt, Timer& timebase) :
+      wdt_(wdt), timebase_(timebase), numTasks_(0), lateTask_(kNoTask) {
+  }
+
+  /**
+   * Registers a task, which counts as checked in now.
+   * Must not be called concurrently with service().
+   *
+   * @param budget_us maximum time allowed between check-ins
+   * @param name optional name, for reporting
+   * @returns task ID to pass into checkIn, or kNoTask if all slots are used
+   */
+  int8_t addTask(uint32_t budget_us, const char* name = NULL) {
+    if (numTasks_ >= MaxTasks) {
+      return kNoTask;
+    }
+    Task& task = tasks_[numTasks_];
+    task.budget_us = budget_us;
+    task.name = name;
+    task.lastCheckIn_us.store(timebase_.read_us());
+    task.checkIns.store(0);
+    task.maxInterval_us.store(0);
+    task.misses = 0;
+    return numTasks_++;
+  }
+
+  /**
+   * Records that a task made progress. Lock-free, safe to call from interrupts.
+   */
+  void checkIn(int8_t id) {
+    Task& task = tasks_[id];
+    uint32_t now = timebase_.read_us();
+    uint32_t previous = task.lastCheckIn_us.exchange(now);
+    uint32_t interval = now - previous;
+    if ((int32_t)interval < 0) {
+      // Preempted by a check-in from another context between reading the time and the exchange,
+      // which is newer, so put it back
+      interval = 0;
+      task.lastCheckIn_us.compare_exchange_strong(now, previous);
+    }
+    uint32_t maxInterval = task.maxInterval_us.load();
+    while (interval > maxInterval
+        && !task.maxInterval_us.compare_exchange_weak(maxInterval, interval)) {
+    }
+    task.checkIns.fetch_add(1);
+  }
+
+  /**
+   * Checks every task against its budget and feeds the watchdog if all are on time.
+   * Also folds check-in intervals into the per-task statistics.
+   *
+   * @returns whether the watchdog was fed
+   */
+  bool service() {
+    int8_t lateTask = kNoTask;
+    for (size_t i=0; i<numTasks_; i++) {
+      Task& task = tasks_[i];
+      // Time read after the last check-in, so a check-in from an interrupt can't be in the future
+      uint32_t lastCheckIn = task.lastCheckIn_us.load();
+      uint32_t now = timebase_.read_us();
+      // Zero means no check-in since the last call (or one still in progress, seen next call)
+      uint32_t interval = task.maxInterval_us.exchange(0);
+      if (interval != 0) {
+        task.intervalStats.addSample(interval);
+        task.intervalHistogram.addSample(budgetPercent(task, interval));
+      }
+      // A task that overran its budget is late, even if it checked in again since
+      if (now - lastCheckIn > task.budget_us || interval > task.budget_us) {
+        task.misses++;
+        if (lateTask == kNoTask) {
+          lateTask = i;
+        }
+      }
+    }
+    lateTask_ = lateTask;
+    if (lateTask == kNoTask) {
+      wdt_.feed();
+      return true;
+    } else {
+      return false;
+    }
+  }
+
+  /**
+   * Returns the first task found late by the last service() call, or kNoTask.
+   */
+  int8_t lateTask() const {
+    return lateTask_;
+  }
+
+  const char* taskName(int8_t id) const {
+    return tasks_[id].name;
+  }
+
+  TaskStats readStats(int8_t id) const {
+    const Task& task = tasks_[id];
+    TaskStats stats;
+    stats.interval_us = task.intervalStats.read();
+    stats.checkIns = task.checkIns.load();
+    stats.misses = task.misses;
+    return stats;
+  }
+
+  /**
+   * Returns the interval histogram of a task, with buckets in percent of its budget.
+   */
+  IntervalHistogram& intervalHistogram(int8_t id) {
+    return tasks_[id].intervalHistogram;
+  }
+
+  void resetStats() {
+    for (size_t i=0; i<numTasks_; i++) {
+      tasks_[i].intervalStats.reset();
+      tasks_[i].intervalHistogram.reset();
+      tasks_[i].misses = 0;
+    }
+  }
+
+protected:
+  struct Task {
+    Task() : intervalHistogram(kIntervalDividers) {
+    }
+
+    uint32_t budget_us;
+    const char* name;
+
+    // written by checkIn
+    atomic<uint32_t> lastCheckIn_us;
+    atomic<uint32_t> maxInterval_us;  // longest interval since the last service(), cleared by it
+    atomic<uint32_t> checkIns;
+
+    // owned by service
+    uint32_t misses;
+    StatisticalCounter<uint32_t, uint64_t> intervalStats;
+    IntervalHistogram intervalHistogram;
+  };
+
+  static uint16_t budgetPercent(const Task& task, uint32_t interval_us) {
+    uint64_t percent = (uint64_t)interval_us * 100 / task.budget_us;
+    return percent > UINT16_MAX ? UINT16_MAX : percent;
+  }
+
+  WDT& wdt_;
+  Timer& timebase_;
+
+  Task tasks_[MaxTasks];
+  size_t numTasks_;
+  int8_t lateTask_;
+};
+
+template <size_t MaxTasks>
+const uint16_t WdtSupervisor<MaxTasks>::kIntervalDividers[kNumIntervalDividers] =
+    {25, 50, 75, 90, 100, 150, 200};
+
+#endif
@@ -0,0 +1,102 @@
+#!/usr/bin/env python
+# Converts a trace ring dump (from calsol::util::trace::dump, see utils/Trace.h) into Chrome trace
+# event JSON, which can be opened in chrome://tracing or https://ui.perfetto.dev.
+#
+# Usage:
+#   python tools/trace_to_chrome.py serial_capture.txt -o trace.json [--name 1=control_loop ...]
+#       [--interrupt 2 ...]
+#
+# Lines outside the "trace <n>" ... "end" block are ignored, so a raw serial capture can be used.
+
+import argparse
+import json
+import sys
+
+LIBRARY_NAMES = {
+  0xf0: 'CANBuffer RX IRQ',
+  0xf1: 'CANBuffer TX IRQ',
+  0xf2: 'DMA IRQ',
+  0xf3: 'DmaSerial put',
+  0xf4: 'DmaSerial DMA transfer',
+}
+
+# Library events recorded in interrupt context. They go on their own track, since B/E spans must
+# nest within a track and interrupts are not nested inside the thread's spans.
+INTERRUPT_IDS = set([0xf0, 0xf1, 0xf2])
+
+THREAD_TID = 0
+INTERRUPT_TID = 1
+
+def parse_records(lines):
+  records = []
+  in_trace = False
+  for line in lines:
+    fields = line.split()
+    if not fields:
+      continue
+    if fields[0] == 'trace':
+      in_trace = True
+      records = []
+    elif fields[0] == 'end':
+      in_trace = False
+    elif in_trace and len(fields) == 4:
+      timestamp, event_type, event_id, arg = [int(field, 16) for field in fields]
+      records.append((timestamp, chr(event_type), event_id, arg))
+  return records
+
+def to_chrome_events(records, names, interrupt_ids):
+  events = [
+    {'name': 'thread_name', 'ph': 'M', 'pid': 0, 'tid': THREAD_TID, 'args': {'name': 'thread'}},
+    {'name': 'thread_name', 'ph': 'M', 'pid': 0, 'tid': INTERRUPT_TID,
+     'args': {'name': 'interrupts'}},
+  ]
+  high_word = 0
+  last_timestamp = None
+  for timestamp, event_type, event_id, arg in records:
+    # unwrap the 32-bit us timestamps, records are in order so a decrease means a wrap
+    if last_timestamp is not None and timestamp < last_timestamp and last_timestamp - timestamp > (1 << 31):
+      high_word += 1 << 32
+    last_timestamp = timestamp
+    event = {
+      'name': names.get(event_id, 'event 0x%02x' % event_id),
+      'ph': event_type,
+      'ts': high_word + timestamp,
+      'pid': 0,
+      'tid': INTERRUPT_TID if event_id in interrupt_ids else THREAD_TID,
+      'args': {'arg': arg},
+    }
+    if event_type == 'i':
+      event['s'] = 't'
+    elif event_type in ('b', 'e'):
+      # async spans (TRACE_ASYNC_*) pair up by id, regardless of context
+      event['cat'] = 'async'
+      event['id'] = event_id
+    events.append(event)
+  return events
+
+def main():
+  parser = argparse.ArgumentParser(description='Convert a trace ring dump to Chrome trace JSON.')
+  parser.add_argument('input', nargs='?', type=argparse.FileType('r'), default=sys.stdin)
+  parser.add_argument('-o', '--output', type=argparse.FileType('w'), default=sys.stdout)
+  parser.add_argument('--name', action='append', default=[],
+                      help='application event name, as id=name (id in decimal or 0x hex)')
+  parser.add_argument('--interrupt', action='append', default=[],
+                      help='application event id recorded in interrupt context, drawn on the '
+                           'interrupt track')
+  args = parser.parse_args()
+
+  names = dict(LIBRARY_NAMES)
+  for name in args.name:
+    event_id, event_name = name.split('=', 1)
+    names[int(event_id, 0)] = event_name
+
+  interrupt_ids = set(INTERRUPT_IDS)
+  for event_id in args.interrupt:
+    interrupt_ids.add(int(event_id, 0))
+
+  records = parse_records(args.input)
+  json.dump({'traceEvents': to_chrome_events(records, names, interrupt_ids), 'displayTimeUnit': 'ms'},
+            args.output, indent=1)
+
+if __name__ == '__main__':
+  main()
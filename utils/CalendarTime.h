@@ -0,0 +1,86 @@
+#ifndef _CALENDAR_TIME_H_
+#define _CALENDAR_TIME_H_
+
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * Allocation-free conversions between Unix epoch seconds and UTC calendar time, without the
+ * timezone handling and table walks of mktime / gmtime. Valid for the proleptic Gregorian
+ * calendar, using the days-from-civil algorithms from
+ * http://howardhinnant.github.io/date_algorithms.html
+ */
+namespace calsol {
+namespace util {
+
+/**
+ * Returns the number of days since 1970-01-01 of a date.
+ *
+ * @param month 1-12
+ * @param day 1-31
+ */
+inline int32_t daysFromCivil(int32_t year, uint32_t month, uint32_t day) {
+  year -= month <= 2;
+  const int32_t era = (year >= 0 ? year : year - 399) / 400;
+  const uint32_t yearOfEra = year - era * 400;  // [0, 399]
+  const uint32_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;  // [0, 365], from March 1
+  const uint32_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;  // [0, 146096]
+  return era * 146097 + (int32_t)dayOfEra - 719468;
+}
+
+/**
+ * Returns the date of a number of days since 1970-01-01.
+ *
+ * @param month output, 1-12
+ * @param day output, 1-31
+ */
+inline void civilFromDays(int32_t days, int32_t* year, uint32_t* month, uint32_t* day) {
+  days += 719468;
+  const int32_t era = (days >= 0 ? days : days - 146096) / 146097;
+  const uint32_t dayOfEra = days - era * 146097;  // [0, 146096]
+  const uint32_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;  // [0, 399]
+  const uint32_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);  // [0, 365], from March 1
+  const uint32_t monthPrime = (5 * dayOfYear + 2) / 153;  // [0, 11], from March
+  *day = dayOfYear - (153 * monthPrime + 2) / 5 + 1;
+  *month = monthPrime < 10 ? monthPrime + 3 : monthPrime - 9;
+  *year = (int32_t)yearOfEra + era * 400 + (*month <= 2);
+}
+
+/**
+ * Converts UTC calendar time to Unix epoch seconds, like timegm. Only the year, month, day,
+ * hour, minute and second fields are used, and they must be in range.
+ */
+inline time_t calendarToEpoch(const tm& time) {
+  int32_t days = daysFromCivil(time.tm_year + 1900, time.tm_mon + 1, time.tm_mday);
+  return (time_t)days * 86400 + time.tm_hour * 3600 + time.tm_min * 60 + time.tm_sec;
+}
+
+/**
+ * Converts Unix epoch seconds to UTC calendar time, like gmtime_r. Fills in all fields, with
+ * tm_isdst cleared.
+ */
+inline void epochToCalendar(time_t epoch, tm* time) {
+  int32_t days = epoch / 86400;
+  int32_t seconds = epoch % 86400;
+  if (seconds < 0) {
+    seconds += 86400;
+    days -= 1;
+  }
+  int32_t year;
+  uint32_t month, day;
+  civilFromDays(days, &year, &month, &day);
+
+  time->tm_year = year - 1900;
+  time->tm_mon = month - 1;
+  time->tm_mday = day;
+  time->tm_hour = seconds / 3600;
+  time->tm_min = (seconds / 60) % 60;
+  time->tm_sec = seconds % 60;
+  time->tm_wday = days >= -4 ? (days + 4) % 7 : (days + 5) % 7 + 6;  // 1970-01-01 was a Thursday
+  time->tm_yday = days - daysFromCivil(year, 1, 1);
+  time->tm_isdst = 0;
+}
+
+}}
+
+#endif
@@ -0,0 +1,127 @@
+#include "ClockDiscipline.h"
+
+#include <algorithm>
+
+ClockDiscipline::ClockDiscipline(LongTimer& timebase) :
+    timebase_(timebase), baseRaw_us_(0), baseCorrected_us_(0), rateQ32_(0), epochOffset_us_(0),
+    edges_(0), lastEdgeRaw_us_(0), idealEdge_us_(0), frequencyQ32_(0), lastPhaseError_us_(0),
+    lockCount_(0) {
+  sequence_.store(0);
+  hasEpoch_.store(false);
+}
+
+void ClockDiscipline::publish(uint64_t baseRaw_us, uint64_t baseCorrected_us, int32_t rateQ32) {
+  __disable_irq();
+  uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+  sequence_.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  baseRaw_us_ = baseRaw_us;
+  baseCorrected_us_ = baseCorrected_us;
+  rateQ32_ = rateQ32;
+
+  sequence_.store(sequence + 2, std::memory_order_release);
+  __enable_irq();
+}
+
+void ClockDiscipline::onSecondEdge() {
+  uint64_t raw_us = timebase_.read_us();
+
+  if (edges_ == 0) {  // first edge, start the model here
+    publish(raw_us, raw_us, 0);
+    idealEdge_us_ = raw_us;
+    lastEdgeRaw_us_ = raw_us;
+    edges_ = 1;
+    return;
+  }
+
+  uint64_t predicted_us = correctedAt(raw_us);
+  uint32_t elapsedSeconds = (predicted_us - idealEdge_us_ + 500000) / 1000000;
+  if (elapsedSeconds == 0) {  // glitch, not a real edge
+    return;
+  }
+
+  if (edges_ == 1) {
+    // Seed the frequency directly from the first interval, so the loop starts close
+    int64_t interval_us = raw_us - lastEdgeRaw_us_;
+    int64_t frequencyQ32 = ((int64_t)elapsedSeconds * 1000000 - interval_us) * ((int64_t)1 << 32) / interval_us;
+    frequencyQ32_ = std::max<int64_t>(-kMaxRateQ32, std::min<int64_t>(kMaxRateQ32, frequencyQ32));
+    idealEdge_us_ = predicted_us;
+    lastEdgeRaw_us_ = raw_us;
+    edges_ = 2;
+    publish(raw_us, predicted_us, frequencyQ32_);
+    return;
+  }
+
+  idealEdge_us_ += (uint64_t)elapsedSeconds * 1000000;
+  int64_t phaseError_us = (int64_t)(idealEdge_us_ - predicted_us);
+  phaseError_us = std::max<int64_t>(-INT32_MAX / kQ32PerUs, std::min<int64_t>(INT32_MAX / kQ32PerUs, phaseError_us));
+  lastPhaseError_us_ = phaseError_us;
+
+  int64_t errorQ32 = phaseError_us * kQ32PerUs / elapsedSeconds;
+  int64_t frequencyQ32 = frequencyQ32_ + (errorQ32 >> kIntegralShift);
+  frequencyQ32_ = std::max<int64_t>(-kMaxRateQ32, std::min<int64_t>(kMaxRateQ32, frequencyQ32));
+  int64_t rateQ32 = frequencyQ32_ + (errorQ32 >> kProportionalShift);
+  rateQ32 = std::max<int64_t>(-kMaxRateQ32, std::min<int64_t>(kMaxRateQ32, rateQ32));
+
+  if (phaseError_us < kLockThreshold_us && phaseError_us > -kLockThreshold_us) {
+    if (lockCount_ < kLockEdges) {
+      lockCount_++;
+    }
+  } else {
+    lockCount_ = 0;
+  }
+
+  lastEdgeRaw_us_ = raw_us;
+  edges_++;
+  publish(raw_us, predicted_us, rateQ32);
+}
+
+uint64_t ClockDiscipline::read_us() {
+  uint32_t sequence;
+  uint64_t raw_us, baseRaw_us, baseCorrected_us;
+  int32_t rateQ32;
+  do {
+    sequence = sequence_.load(std::memory_order_acquire);
+    baseRaw_us = baseRaw_us_;
+    baseCorrected_us = baseCorrected_us_;
+    rateQ32 = rateQ32_;
+    raw_us = timebase_.read_us();
+    std::atomic_thread_fence(std::memory_order_acquire);
+  } while ((sequence & 1) || sequence != sequence_.load(std::memory_order_relaxed));
+
+  int64_t elapsed = raw_us - baseRaw_us;
+  return baseCorrected_us + elapsed + ((elapsed * rateQ32) >> 32);
+}
+
+void ClockDiscipline::setEpoch(time_t secondsAtLastEdge) {
+  __disable_irq();  // consistent with idealEdge_us_, which the edge interrupt updates
+  uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+  sequence_.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  epochOffset_us_ = (int64_t)secondsAtLastEdge * 1000000 - (int64_t)idealEdge_us_;
+
+  sequence_.store(sequence + 2, std::memory_order_release);
+  __enable_irq();
+  hasEpoch_.store(true);
+}
+
+uint64_t ClockDiscipline::readEpoch_us() {
+  int64_t epochOffset_us;
+  uint32_t sequence;
+  do {
+    sequence = sequence_.load(std::memory_order_acquire);
+    epochOffset_us = epochOffset_us_;
+    std::atomic_thread_fence(std::memory_order_acquire);
+  } while ((sequence & 1) || sequence != sequence_.load(std::memory_order_relaxed));
+  return read_us() + epochOffset_us;
+}
+
+time_t ClockDiscipline::readEpoch() {
+  return readEpoch_us() / 1000000;
+}
+
+int32_t ClockDiscipline::frequencyCorrectionPpb() const {
+  return ((int64_t)frequencyQ32_ * 1000000000) >> 32;
+}
@@ -0,0 +1,120 @@
+#ifndef _CLOCK_DISCIPLINE_H_
+#define _CLOCK_DISCIPLINE_H_
+
+#include <atomic>
+#include <time.h>
+
+#include "mbed.h"
+
+#include "LongTimer.h"
+
+/**
+ * Disciplines LongTimer time to a precise 1 Hz reference, like the PCF2129 second interrupt,
+ * giving drift-corrected microseconds and wall-clock time.
+ *
+ * Each second edge is timestamped with the LongTimer, and a PI loop on the phase error between
+ * the corrected time and the ideal edge times estimates the LongTimer frequency error. Corrected
+ * time is a linear model (base + elapsed * (1 + rate)) rebased at each edge, so it is continuous
+ * and monotonic, and reads are O(1). The model is protected by a sequence lock, so reads are safe
+ * from any thread or interrupt.
+ *
+ * Missed edges are tolerated, and corrected time extrapolates from the last rate estimate while
+ * edges are missing (for up to about a day, before the model arithmetic overflows).
+ */
+class ClockDiscipline {
+public:
+  static const int32_t kMaxRateQ32 = 85899346;  // +/-2% frequency correction limit
+
+  ClockDiscipline(LongTimer& timebase);
+
+  /**
+   * Call this on each 1 Hz reference edge, typically from the interrupt handler.
+   */
+  void onSecondEdge();
+
+  /**
+   * Returns the corrected time in microseconds, on the same scale as LongTimer time.
+   */
+  uint64_t read_us();
+
+  /**
+   * Sets the wall-clock time, in seconds since the Unix epoch, of the most recent second edge.
+   * For the PCF2129, read the RTC time right after an edge and pass it in.
+   */
+  void setEpoch(time_t secondsAtLastEdge);
+
+  bool hasEpoch() const {
+    return hasEpoch_.load();
+  }
+
+  /**
+   * Returns the corrected wall-clock time, in microseconds since the Unix epoch.
+   * Only meaningful once setEpoch has been called.
+   */
+  uint64_t readEpoch_us();
+
+  /**
+   * Returns the corrected wall-clock time, in seconds since the Unix epoch.
+   */
+  time_t readEpoch();
+
+  /**
+   * Returns the estimated frequency correction, in parts per billion, positive when the
+   * LongTimer runs slow.
+   */
+  int32_t frequencyCorrectionPpb() const;
+
+  /**
+   * Returns the phase error, in us, seen at the last edge.
+   */
+  int32_t lastPhaseError_us() const {
+    return lastPhaseError_us_;
+  }
+
+  /**
+   * Returns whether the phase error has stayed within the lock threshold for several edges.
+   */
+  bool locked() const {
+    return lockCount_ >= kLockEdges;
+  }
+
+protected:
+  static const int32_t kQ32PerUs = 4295;  // 2^32 / 1e6, converts a per-second us error to Q32
+  static const uint8_t kProportionalShift = 2;  // corrects 1/4 of the phase error per second
+  static const uint8_t kIntegralShift = 4;
+  static const int32_t kLockThreshold_us = 50;
+  static const uint8_t kLockEdges = 8;
+
+  /**
+   * Evaluates the model at a LongTimer time, without the sequence lock (writer side).
+   */
+  uint64_t correctedAt(uint64_t raw_us) const {
+    int64_t elapsed = raw_us - baseRaw_us_;
+    return baseCorrected_us_ + elapsed + ((elapsed * rateQ32_) >> 32);
+  }
+
+  /**
+   * Replaces the model, under the sequence lock.
+   */
+  void publish(uint64_t baseRaw_us, uint64_t baseCorrected_us, int32_t rateQ32);
+
+  LongTimer& timebase_;
+
+  // Model, protected by sequence_
+  atomic<uint32_t> sequence_;  // odd while the model is being modified
+  uint64_t baseRaw_us_;  // LongTimer time the model was last rebased at
+  uint64_t baseCorrected_us_;  // corrected time at baseRaw_us_
+  int32_t rateQ32_;  // correction to the LongTimer rate, as a Q32 fraction
+  int64_t epochOffset_us_;  // epoch microseconds minus corrected microseconds
+  atomic<bool> hasEpoch_;
+
+  // Loop state, owned by onSecondEdge
+  uint32_t edges_;
+  uint64_t lastEdgeRaw_us_;
+  uint64_t idealEdge_us_;  // corrected time the last edge ideally happened at
+  int32_t frequencyQ32_;  // integral term
+  int32_t lastPhaseError_us_;
+  uint8_t lockCount_;
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef _I2C_BUS_H_
+#define _I2C_BUS_H_
+
+#include "mbed.h"
+
+/**
+ * A single-byte register read or write on an I2C device, queued on an I2cBus.
+ * Intrusive: the bus links the transaction itself, so it must stay in memory until complete.
+ */
+struct I2cTransaction {
+  enum Status {
+    kPending,
+    kOk,
+    kNak,  // the device did not acknowledge, after all retries
+    kBusError,  // arbitration loss or bus error, after all retries
+  };
+
+  I2cTransaction() :
+      address(0), reg(0), read(false), value(0), status(kOk), next_(NULL), merged_(NULL) {
+  }
+
+  int address;  // 8-bit device address, as used by the mbed I2C API
+  uint8_t reg;
+  bool read;
+  uint8_t value;  // value to write, or value read on completion
+  Callback<void()> done;  // fired on completion, possibly from interrupt context
+
+  volatile Status status;  // kPending until complete, set before done fires
+
+  I2cTransaction* next_;  // queue link, owned by the bus
+  I2cTransaction* merged_;  // later writes to the same register merged into this one
+};
+
+/**
+ * An I2C bus shared by multiple devices, which runs queued register transactions in order.
+ */
+class I2cBus {
+public:
+  virtual ~I2cBus() {}
+
+  /**
+   * Queues a transaction. Safe to call from interrupt context, including done callbacks.
+   * A write to the same device register as a queued write that has not started yet is merged
+   * into it, so only the latest value is sent; both complete together.
+   */
+  virtual void submit(I2cTransaction& transaction) = 0;
+
+  /**
+   * Queues a transaction and waits for it to complete. Must not be called from interrupt context.
+   *
+   * @returns whether the transaction succeeded
+   */
+  bool transfer(I2cTransaction& transaction) {
+    submit(transaction);
+    while (transaction.status == I2cTransaction::kPending);
+    return transaction.status == I2cTransaction::kOk;
+  }
+};
+
+#endif
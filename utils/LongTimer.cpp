@@ -1,20 +1,19 @@
 #include "LongTimer.h"
 
 void LongTimer::update() {
-  // NOT THREAD SAFE, only one thread may do updates.
-  uint32_t currentUs = (uint32_t)usTimer_.read_us();
-
-  uint8_t currentIndex = currentIndex_.load(std::memory_order_acquire);
-  uint8_t nextIndex = (currentIndex + 1) % 2;
+  __disable_irq();
+  uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+  sequence_.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
 
-  uint32_t currentRollover = usRollovers_[currentIndex].load(std::memory_order_relaxed);
-  if (currentUs < lastUs_[currentIndex]) {
-    currentRollover += 1;
+  uint32_t currentUs = (uint32_t)usTimer_.read_us();
+  if (currentUs < lastUs_.load(std::memory_order_relaxed)) {
+    usRollovers_.store(usRollovers_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
   }
-  usRollovers_[nextIndex].store(currentRollover, std::memory_order_relaxed);
-  lastUs_[nextIndex].store(currentUs, std::memory_order_relaxed);
+  lastUs_.store(currentUs, std::memory_order_relaxed);
 
-  currentIndex_.store(nextIndex, std::memory_order_release);
+  sequence_.store(sequence + 2, std::memory_order_release);
+  __enable_irq();
 }
 
 uint32_t LongTimer::read_short_us() {
@@ -22,12 +21,16 @@ uint32_t LongTimer::read_short_us() {
 }
 
 uint64_t LongTimer::read_us() {
-  // NOT THREAD SAFE, but is interrupt-safe with update.
-  uint32_t currentUs = (uint32_t)usTimer_.read_us();
-  uint64_t longUs;
-  uint8_t bufferedCurrentIndex = currentIndex_.load(std::memory_order_acquire);
-  uint32_t currentRollover = usRollovers_[bufferedCurrentIndex].load(std::memory_order_relaxed);
-  if (currentUs < lastUs_[bufferedCurrentIndex]) {
+  uint32_t sequence, currentUs, lastUs, currentRollover;
+  do {
+    sequence = sequence_.load(std::memory_order_acquire);
+    lastUs = lastUs_.load(std::memory_order_relaxed);
+    currentRollover = usRollovers_.load(std::memory_order_relaxed);
+    currentUs = (uint32_t)usTimer_.read_us();
+    std::atomic_thread_fence(std::memory_order_acquire);
+  } while ((sequence & 1) || sequence != sequence_.load(std::memory_order_relaxed));
+
+  if (currentUs < lastUs) {
     currentRollover += 1;
   }
   return ((uint64_t)currentRollover << 32) | currentUs;
@@ -40,7 +43,26 @@ uint32_t LongTimer::read_ms() {
 bool TimerTicker::checkExpired() {
   uint32_t currentUs = timer_.read_us();
   if (LongTimer::timePast(currentUs, tickerExpire_)) {
-    tickerExpire_ += period_;
+    uint32_t lateUs = currentUs - tickerExpire_;
+    uint32_t behindPeriods = lateUs / period_;
+    lateness_.addSample(lateUs);
+
+    switch (policy_) {
+    case kFireAll:
+      if (behindPeriods > 0) {  // this expiration is itself a back-to-back catch-up
+        missedPeriods_++;
+      }
+      tickerExpire_ += period_;
+      break;
+    case kSkipToNow:
+      missedPeriods_ += behindPeriods;
+      tickerExpire_ += (behindPeriods + 1) * period_;
+      break;
+    case kFireOnceRealign:
+      missedPeriods_ += behindPeriods;
+      tickerExpire_ = currentUs + period_;
+      break;
+    }
     return true;
   }
   return false;
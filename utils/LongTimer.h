@@ -5,31 +5,33 @@
 
 #include "mbed.h"
 
+#include "StatisticalCounter.h"
+
 /**
  * Long timer that is effectively a 64-bit us timer.
  *
  * Does NOT start started.
  *
- * Uses the mbed timer API with an extra 32-bit overflow timer.
- * update() must only be called from one thread, but read_us and read_ms are
- * interrupt safe and do not modify internal state.
- * read_us and read_ms are NOT completely thread-safe, but should be fine in
- * almost all cases (where threads are switched much faster than the us timer
- * overflow period).
+ * Uses the mbed timer API with an extra 32-bit overflow counter, kept current by an internal
+ * Ticker that calls update() well within every timer overflow period.
+ * The overflow state is protected by a sequence lock: update() bumps the sequence number before
+ * and after modifying state (with interrupts disabled, so writers never interleave), and readers
+ * retry if the sequence number was odd or changed across their read. read_us and read_ms are
+ * safe from any thread or interrupt.
  */
 class LongTimer {
 public:
   LongTimer(Timer& usTimer) : usTimer_(usTimer) {
-    currentIndex_.store(0);
-    for (uint8_t i=0; i<2; i++) {
-      lastUs_[i].store(0);
-      usRollovers_[i].store(0);
-    }
+    sequence_.store(0);
+    lastUs_.store(0);
+    usRollovers_.store(0);
+    updateTicker_.attach_us(callback(this, &LongTimer::update), kUpdatePeriodUs);
   }
 
   /**
-   * Call this every once in a while (no longer than every 30 minutes) to check
-   * for overflows and update internal state as necessary.
+   * Checks for overflows and updates internal state as necessary. Called automatically from the
+   * internal Ticker, but may also be called from thread or interrupt context (it briefly disables
+   * interrupts).
    */
   void update();
 
@@ -65,20 +67,33 @@ public:
   }
 
 protected:
+  static const uint32_t kUpdatePeriodUs = 1 << 30;  // a quarter of the 32-bit us timer overflow period
+
   Timer& usTimer_;
+  Ticker updateTicker_;
 
-  atomic<uint8_t> currentIndex_;  // points to the state index that is safe to read from
-  atomic<uint32_t> lastUs_[2];  // last usTimer read_us result on update
-  atomic<uint32_t> usRollovers_[2];  // number of times usTimer has rolled over, essentially the high 32-bit word of a 64-bit us counter
+  atomic<uint32_t> sequence_;  // odd while update is modifying state
+  atomic<uint32_t> lastUs_;  // last usTimer read_us result on update
+  atomic<uint32_t> usRollovers_;  // number of times usTimer has rolled over, essentially the high 32-bit word of a 64-bit us counter
 };
 
 /**
  * A ticker that can be polled for expiration. Long-term stable.
+ *
+ * Records how late each expiration was noticed, to show scheduling jitter, and counts missed
+ * periods when polling falls more than a period behind. What happens to missed periods is set by
+ * the catch-up policy.
  */
 class TimerTicker {
 public:
-  TimerTicker(uint32_t period_us, Timer& timer) :
-      period_(period_us), timer_(timer) {
+  enum CatchUpPolicy {
+    kFireAll,  // fire once per missed period, back-to-back, keeping the phase (default)
+    kSkipToNow,  // fire once, dropping missed periods, keeping the phase
+    kFireOnceRealign,  // fire once, dropping missed periods, restarting the period from now
+  };
+
+  TimerTicker(uint32_t period_us, Timer& timer, CatchUpPolicy policy = kFireAll) :
+      period_(period_us), timer_(timer), policy_(policy), missedPeriods_(0) {
     tickerExpire_ = timer.read_us() + period_;
   }
 
@@ -93,11 +108,35 @@ public:
    */
   void reset();
 
+  /**
+   * Returns the number of periods that expired more than a period before being noticed. With
+   * kFireAll these still fire late, back-to-back; otherwise they are dropped.
+   */
+  uint32_t missedPeriods() const {
+    return missedPeriods_;
+  }
+
+  /**
+   * Returns statistics of how late, in us, expirations were noticed.
+   */
+  StatisticalCounter<uint32_t, uint64_t>::StatisticalResult readLateness() const {
+    return lateness_.read();
+  }
+
+  void resetStats() {
+    missedPeriods_ = 0;
+    lateness_.reset();
+  }
+
 protected:
   const uint32_t period_;  // period of ticker, in us
 
   Timer& timer_;  // reference to timebase
   uint32_t tickerExpire_;  // 32-bit time, in us, at which ticker is set to expire
+
+  const CatchUpPolicy policy_;
+  uint32_t missedPeriods_;
+  StatisticalCounter<uint32_t, uint64_t> lateness_;  // in us
 };
 
 #endif
@@ -0,0 +1,54 @@
+#include "Profile.h"
+
+#ifdef PROFILE_ENABLED
+
+#if !defined(__CORTEX_M)
+#include <chrono>
+#endif
+
+namespace calsol {
+namespace util {
+namespace profile {
+
+const uint32_t kDividers[kNumDividers] = {100, 300, 1000, 3000, 10000, 30000, 100000};
+
+#if !defined(__CORTEX_M)
+uint32_t now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+Zone zones[PROFILE_MAX_ZONES];
+uint32_t overhead = 0;
+
+void init() {
+#if defined(__CORTEX_M)
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+  // Take the minimum of a few empty scopes as the overhead, using a zone slot as scratch
+  const uint8_t kCalibrationZone = 0;
+  overhead = 0;
+  for (uint8_t i=0; i<8; i++) {
+    PROFILE_SCOPE(kCalibrationZone);
+  }
+  overhead = zones[kCalibrationZone].duration.read().min;
+  reset();
+}
+
+void nameZone(uint8_t id, const char* name) {
+  zones[id].name = name;
+}
+
+void reset() {
+  for (size_t id=0; id<PROFILE_MAX_ZONES; id++) {
+    zones[id].duration.reset();
+    zones[id].histogram.reset();
+  }
+}
+
+}}}
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+#ifndef __ZEPHYR_COMMON_NO_MBED__
+#include "mbed.h"
+#endif // __ZEPHYR_COMMON_NO_MBED__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <cstdio>
+
+#include "StatisticalCounter.h"
+#include "Histogram.h"
+#include "SerialRetry.h"
+
+/**
+ * Hot-path profiling: PROFILE_SCOPE(id) times the rest of the enclosing scope and accumulates
+ * the duration into the zone's StatisticalCounter and Histogram.
+ *
+ * Durations are in CPU cycles from the DWT cycle counter on target, and in ns on the host (built
+ * with __ZEPHYR_COMMON_NO_MBED__ defined, as for can_buffer.h).
+ * The measured overhead of an empty scope is subtracted from every sample.
+ * A zone must only be used from one execution context (the main loop, or interrupts of one
+ * priority), since sample accumulation is not atomic.
+ *
+ * Everything compiles to nothing unless PROFILE_ENABLED is defined (project-wide).
+ */
+#ifndef PROFILE_MAX_ZONES
+  #define PROFILE_MAX_ZONES 16
+#endif
+
+namespace calsol {
+namespace util {
+namespace profile {
+
+#ifdef PROFILE_ENABLED
+
+const size_t kNumDividers = 7;
+extern const uint32_t kDividers[kNumDividers];  // histogram bucket limits, in cycles or ns
+
+struct Zone {
+  Zone() : name(NULL), histogram(kDividers) {
+  }
+
+  const char* name;
+  StatisticalCounter<uint32_t, uint64_t> duration;
+  Histogram<kNumDividers, uint32_t, uint32_t> histogram;
+};
+
+extern Zone zones[PROFILE_MAX_ZONES];
+extern uint32_t overhead;  // duration of an empty scope, subtracted from samples
+
+#if defined(__CORTEX_M)
+const char* const kUnit = "cycles";
+
+inline uint32_t now() {
+  return DWT->CYCCNT;
+}
+#else
+const char* const kUnit = "ns";
+
+uint32_t now();
+#endif
+
+/**
+ * Starts the cycle counter and measures the scope overhead, call once at startup.
+ */
+void init();
+
+/**
+ * Sets the name of a zone, shown in the report.
+ */
+void nameZone(uint8_t id, const char* name);
+
+/**
+ * Clears all zone statistics.
+ */
+void reset();
+
+inline void record(uint8_t id, uint32_t start) {
+  uint32_t duration = now() - start;
+  duration = duration > overhead ? duration - overhead : 0;
+  zones[id].duration.addSample(duration);
+  zones[id].histogram.addSample(duration);
+}
+
+class Scope {
+public:
+  Scope(uint8_t id) : id_(id), start_(now()) {
+  }
+
+  ~Scope() {
+    record(id_, start_);
+  }
+
+protected:
+  const uint8_t id_;
+  const uint32_t start_;
+};
+
+/**
+ * Writes a report of all zones with samples, one statistics line and one histogram line each.
+ * Waits for space in the serial queue rather than dropping lines, see putsRetry.
+ *
+ * @tparam S serial type with puts(const char*), such as DmaSerialBase
+ */
+template <typename S>
+void dump(S& serial) {
+  char buffer[96];
+  snprintf(buffer, sizeof(buffer), "profile (%s, overhead %lu)\r\n",
+      kUnit, (unsigned long)overhead);
+  putsRetry(serial, buffer);
+  for (size_t id=0; id<PROFILE_MAX_ZONES; id++) {
+    StatisticalCounter<uint32_t, uint64_t>::StatisticalResult stats = zones[id].duration.read();
+    if (stats.numSamples == 0) {
+      continue;
+    }
+    snprintf(buffer, sizeof(buffer), "%2u %-16s n=%lu min=%lu avg=%lu max=%lu sd=%lu\r\n",
+        (unsigned)id, zones[id].name != NULL ? zones[id].name : "",
+        (unsigned long)stats.numSamples, (unsigned long)stats.min, (unsigned long)stats.avg,
+        (unsigned long)stats.max, (unsigned long)stats.stdev);
+    putsRetry(serial, buffer);
+
+    const uint32_t* dividers;
+    const uint32_t* counts;
+    size_t numBuckets = zones[id].histogram.read(&dividers, &counts);
+    putsRetry(serial, "   ");
+    for (size_t i=0; i<numBuckets; i++) {
+      if (i < numBuckets - 1) {
+        snprintf(buffer, sizeof(buffer), " <%lu:%lu", (unsigned long)dividers[i],
+            (unsigned long)counts[i]);
+      } else {
+        snprintf(buffer, sizeof(buffer), " >=%lu:%lu\r\n", (unsigned long)dividers[i-1],
+            (unsigned long)counts[i]);
+      }
+      putsRetry(serial, buffer);
+    }
+  }
+}
+
+#define PROFILE_CONCAT_(a, b) a ## b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(id)  \
+  calsol::util::profile::Scope PROFILE_CONCAT(profileScope, __LINE__)(id)
+
+#else
+
+inline void init() {}
+inline void nameZone(uint8_t, const char*) {}
+inline void reset() {}
+template <typename S>
+void dump(S&) {}
+
+#define PROFILE_SCOPE(id)
+
+#endif
+
+}}}
+
+#endif
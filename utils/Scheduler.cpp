@@ -0,0 +1,159 @@
+#include "Scheduler.h"
+
+#include <algorithm>
+
+SchedulerBase::SchedulerBase(LongTimer& timebase, Task* tasks, size_t maxTasks) :
+    timebase_(timebase), tasks_(tasks), maxTasks_(maxTasks), numTasks_(0), phasesAssigned_(false),
+    busy_us_(0) {
+  statsStart_us_ = timebase_.read_us();
+}
+
+int8_t SchedulerBase::addTask(Callback<void()> callback, uint32_t period_us, uint32_t deadline_us,
+    uint8_t priority, uint32_t phase_us, const char* name) {
+  if (numTasks_ >= maxTasks_) {
+    return kNoTask;
+  }
+  Task& task = tasks_[numTasks_];
+  task.autoPhase = (phase_us == kAutoPhase) && !phasesAssigned_;
+  if (phase_us == kAutoPhase) {
+    phase_us = 0;  // offset by assignPhases at the first dispatch
+  }
+
+  task.callback = callback;
+  task.name = name;
+  task.period_us = period_us;
+  task.deadline_us = deadline_us != 0 ? deadline_us : period_us;
+  task.priority = priority;
+  task.release_us = timebase_.read_us() + phase_us;
+  task.absDeadline_us = task.release_us + task.deadline_us;
+  task.execution_us.reset();
+  task.overruns = 0;
+  task.skippedReleases = 0;
+  return numTasks_++;
+}
+
+static uint32_t gcd(uint32_t a, uint32_t b) {
+  while (b != 0) {
+    uint32_t remainder = a % b;
+    a = b;
+    b = remainder;
+  }
+  return a;
+}
+
+void SchedulerBase::assignPhases() {
+  // Releases of every task repeat modulo the GCD of the periods, so spreading the first
+  // releases evenly over one GCD keeps auto-phased tasks from ever releasing together.
+  // When the GCD is too small to give each task its own offset (such as coprime periods), some
+  // releases will coincide whatever the phases, so the first releases are instead spread over
+  // the shortest period, which keeps them distinct and releases mostly apart.
+  size_t numAuto = 0;
+  uint32_t periodGcd = 0;
+  uint32_t minPeriod = UINT32_MAX;
+  for (size_t i=0; i<numTasks_; i++) {
+    if (tasks_[i].autoPhase) {
+      numAuto++;
+      periodGcd = gcd(periodGcd, tasks_[i].period_us);
+      minPeriod = std::min(minPeriod, tasks_[i].period_us);
+    }
+  }
+  uint32_t spread_us = periodGcd >= numAuto ? periodGcd : minPeriod;
+
+  uint64_t now_us = timebase_.read_us();
+  size_t index = 0;
+  for (size_t i=0; i<numTasks_; i++) {
+    Task& task = tasks_[i];
+    if (task.autoPhase) {
+      task.release_us = now_us + (uint64_t)spread_us * index / numAuto;
+      task.absDeadline_us = task.release_us + task.deadline_us;
+      task.autoPhase = false;
+      index++;
+    }
+  }
+  phasesAssigned_ = true;
+}
+
+bool SchedulerBase::dispatch() {
+  if (!phasesAssigned_) {
+    assignPhases();
+  }
+  uint64_t start_us = timebase_.read_us();
+
+  Task* next = NULL;
+  for (size_t i=0; i<numTasks_; i++) {
+    Task& task = tasks_[i];
+    if (task.release_us <= start_us
+        && (next == NULL || task.absDeadline_us < next->absDeadline_us
+            || (task.absDeadline_us == next->absDeadline_us && task.priority > next->priority))) {
+      next = &task;
+    }
+  }
+  if (next == NULL) {
+    return false;
+  }
+
+  uint64_t taskStart_us = timebase_.read_us();
+  next->callback.call();
+  uint64_t taskEnd_us = timebase_.read_us();
+
+  uint32_t execution_us = taskEnd_us - taskStart_us;
+  next->execution_us.addSample(execution_us);
+  busy_us_ += execution_us;
+  if (taskEnd_us > next->absDeadline_us) {
+    next->overruns++;
+  }
+
+  next->release_us += next->period_us;
+  if (taskEnd_us >= next->release_us + next->period_us) {  // too far behind, drop missed releases
+    uint32_t missed = (taskEnd_us - next->release_us) / next->period_us;
+    next->release_us += (uint64_t)missed * next->period_us;
+    next->skippedReleases += missed;
+  }
+  next->absDeadline_us = next->release_us + next->deadline_us;
+
+  dispatch_us_.addSample((taskStart_us - start_us) + (uint32_t)(timebase_.read_us() - taskEnd_us));
+  return true;
+}
+
+void SchedulerBase::run() {
+  while (true) {
+    dispatch();
+  }
+}
+
+uint64_t SchedulerBase::nextRelease_us() const {
+  uint64_t next = UINT64_MAX;
+  for (size_t i=0; i<numTasks_; i++) {
+    if (tasks_[i].release_us < next) {
+      next = tasks_[i].release_us;
+    }
+  }
+  return next;
+}
+
+SchedulerBase::LoadStats SchedulerBase::readLoadStats() {
+  LoadStats stats;
+  stats.elapsed_us = timebase_.read_us() - statsStart_us_;
+  stats.busy_us = busy_us_;
+  stats.dispatch_us = dispatch_us_.read();
+  return stats;
+}
+
+uint16_t SchedulerBase::idlePermille() {
+  uint64_t elapsed_us = timebase_.read_us() - statsStart_us_;
+  if (elapsed_us == 0 || busy_us_ >= elapsed_us) {
+    return 0;
+  }
+  return (elapsed_us - busy_us_) * 1000 / elapsed_us;
+}
+
+void SchedulerBase::resetStats() {
+  statsStart_us_ = timebase_.read_us();
+  busy_us_ = 0;
+  dispatch_us_.reset();
+  for (size_t i=0; i<numTasks_; i++) {
+    tasks_[i].execution_us.reset();
+    tasks_[i].overruns = 0;
+    tasks_[i].skippedReleases = 0;
+  }
+}
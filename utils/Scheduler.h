@@ -0,0 +1,123 @@
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+#include "mbed.h"
+
+#include "LongTimer.h"
+#include "StatisticalCounter.h"
+
+/**
+ * Run-to-completion cooperative scheduler for periodic tasks, dispatching the released task with
+ * the earliest absolute deadline first (ties going to the higher priority), timed against a
+ * LongTimer.
+ *
+ * Records per-task execution time statistics and deadline overruns, and the overall idle fraction,
+ * to replace hand-rolled loops of TimerTickers.
+ * Not thread-safe, all methods must be called from the main loop.
+ */
+class SchedulerBase {
+public:
+  static const int8_t kNoTask = -1;
+  static const uint32_t kAutoPhase = UINT32_MAX;
+
+  struct Task {
+    Callback<void()> callback;
+    const char* name;
+    uint32_t period_us;
+    uint32_t deadline_us;  // relative to each release
+    uint8_t priority;  // higher runs first among equal deadlines
+    bool autoPhase;  // first release still to be staggered by assignPhases
+
+    uint64_t release_us;  // LongTimer time of the next (or current, if not yet run) release
+    uint64_t absDeadline_us;  // deadline of that release
+
+    StatisticalCounter<uint32_t, uint64_t> execution_us;
+    uint32_t overruns;  // runs that finished after their deadline
+    uint32_t skippedReleases;  // releases dropped because the task fell more than a period behind
+  };
+
+  struct LoadStats {
+    uint64_t elapsed_us;  // since the last resetStats
+    uint64_t busy_us;  // time spent running tasks
+    StatisticalCounter<uint32_t, uint64_t>::StatisticalResult dispatch_us;  // scheduler overhead per dispatch
+  };
+
+  SchedulerBase(LongTimer& timebase, Task* tasks, size_t maxTasks);
+
+  /**
+   * Registers a periodic task, which must be done before the first dispatch.
+   *
+   * @param deadline_us deadline relative to each release, or 0 for the period
+   * @param phase_us offset of the first release from now, or kAutoPhase to stagger the first
+   *     releases of all such tasks evenly over the GCD of their periods (or over the shortest
+   *     period, if the GCD is smaller than the number of such tasks), once all tasks are
+   *     registered at the first dispatch
+   * @returns the task ID, or kNoTask if all slots are used
+   */
+  int8_t addTask(Callback<void()> callback, uint32_t period_us, uint32_t deadline_us = 0,
+      uint8_t priority = 0, uint32_t phase_us = kAutoPhase, const char* name = NULL);
+
+  /**
+   * Runs the released task with the earliest deadline, if any.
+   *
+   * @returns whether a task was run
+   */
+  bool dispatch();
+
+  /**
+   * Dispatches tasks forever.
+   */
+  void run();
+
+  /**
+   * Returns the LongTimer time of the earliest upcoming release, the loop can sleep until then.
+   */
+  uint64_t nextRelease_us() const;
+
+  const Task& task(int8_t id) const {
+    return tasks_[id];
+  }
+
+  size_t numTasks() const {
+    return numTasks_;
+  }
+
+  LoadStats readLoadStats();
+
+  /**
+   * Returns the fraction of time not spent running tasks since the last resetStats, in 1/1000.
+   */
+  uint16_t idlePermille();
+
+  void resetStats();
+
+protected:
+  LongTimer& timebase_;
+  Task* const tasks_;
+  const size_t maxTasks_;
+  size_t numTasks_;
+  bool phasesAssigned_;
+
+  // Sets the first release of kAutoPhase tasks, once all tasks are registered
+  void assignPhases();
+
+  uint64_t statsStart_us_;
+  uint64_t busy_us_;
+  StatisticalCounter<uint32_t, uint64_t> dispatch_us_;
+};
+
+/**
+ * @tparam MaxTasks maximum number of registered tasks
+ */
+template <size_t MaxTasks>
+class Scheduler : public SchedulerBase {
+public:
+  Scheduler(LongTimer& timebase) :
+      SchedulerBase(timebase, tasks_, MaxTasks) {
+  }
+
+protected:
+  Task tasks_[MaxTasks];
+};
+
+#endif
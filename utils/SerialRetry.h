@@ -0,0 +1,28 @@
+#ifndef _SERIAL_RETRY_H_
+#define _SERIAL_RETRY_H_
+
+#include <cstdio>
+
+namespace calsol {
+namespace util {
+
+/**
+ * Writes a string, retrying while the serial rejects it (returns EOF), so reports written line
+ * by line through a full queue are delayed rather than silently losing lines.
+ *
+ * The serial must discard the whole string when it returns EOF, as DmaSerialBase does with its
+ * default kReject policy (or kBlock), otherwise partially queued strings are repeated.
+ * Must not be called where the queue can't drain, such as from interrupts that mask the DMA
+ * interrupt.
+ *
+ * @tparam S serial type with puts(const char*)
+ */
+template <typename S>
+void putsRetry(S& serial, const char* str) {
+  while (serial.puts(str) == EOF) {
+  }
+}
+
+}}
+
+#endif
@@ -0,0 +1,21 @@
+#include "SpiBus.h"
+
+void BlockingSpiBus::submit(SpiTransaction& transaction) {
+  transaction.complete = false;
+  if (transaction.cs != NULL) {
+    *transaction.cs = 0;
+  }
+  for (size_t i=0; i<transaction.length; i++) {
+    uint8_t rx = spi_.write(transaction.tx != NULL ? transaction.tx[i] : 0);
+    if (transaction.rx != NULL) {
+      transaction.rx[i] = rx;
+    }
+  }
+  if (transaction.cs != NULL) {
+    *transaction.cs = 1;
+  }
+  transaction.complete = true;
+  if (transaction.done) {
+    transaction.done();
+  }
+}
@@ -0,0 +1,63 @@
+#ifndef _SPI_BUS_H_
+#define _SPI_BUS_H_
+
+#include "mbed.h"
+
+/**
+ * A single chip-select window of full-duplex SPI bytes, queued on a SpiBus.
+ * Intrusive: the bus links the transaction itself, so it and its buffers must stay in memory
+ * until complete.
+ */
+struct SpiTransaction {
+  SpiTransaction() :
+      cs(NULL), tx(NULL), rx(NULL), length(0), complete(true), next_(NULL) {
+  }
+
+  DigitalOut* cs;  // active-low chip select, or NULL if handled elsewhere
+  const uint8_t* tx;  // bytes to send, or NULL to send zeros
+  uint8_t* rx;  // received bytes, or NULL to discard them
+  size_t length;
+  Callback<void()> done;  // fired on completion, possibly from interrupt context
+
+  volatile bool complete;  // cleared on submit, set on completion before done fires
+
+  SpiTransaction* next_;  // queue link, owned by the bus
+};
+
+/**
+ * An SPI bus shared by multiple devices, which runs queued transactions in order.
+ */
+class SpiBus {
+public:
+  virtual ~SpiBus() {}
+
+  /**
+   * Queues a transaction. Safe to call from interrupt context, including done callbacks.
+   * Depending on the bus, it may run before this returns.
+   */
+  virtual void submit(SpiTransaction& transaction) = 0;
+
+  /**
+   * Queues a transaction and waits for it to complete. Must not be called from interrupt context.
+   */
+  void transfer(SpiTransaction& transaction) {
+    submit(transaction);
+    while (!transaction.complete);
+  }
+};
+
+/**
+ * SpiBus on a plain mbed SPI, running each transaction byte-by-byte as it is submitted.
+ */
+class BlockingSpiBus : public SpiBus {
+public:
+  BlockingSpiBus(SPI& spi) : spi_(spi) {
+  }
+
+  void submit(SpiTransaction& transaction);
+
+protected:
+  SPI& spi_;
+};
+
+#endif
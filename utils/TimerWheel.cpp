@@ -0,0 +1,201 @@
+#include "TimerWheel.h"
+
+TimerWheel::TimerWheel(LongTimer& timebase, uint8_t tickShift) :
+    timebase_(timebase), tickShift_(tickShift), pending_(NULL) {
+  currentTick_ = timebase_.read_us() >> tickShift_;
+  for (uint8_t level=0; level<kLevels; level++) {
+    for (uint8_t slot=0; slot<kSlots; slot++) {
+      slots_[level][slot] = NULL;
+    }
+    occupied_[level] = 0;
+  }
+}
+
+void TimerWheel::start(WheelTimer& timer, uint32_t delay_us, uint32_t period_us) {
+  startAt(timer, timebase_.read_us() + delay_us, period_us);
+}
+
+void TimerWheel::startAt(WheelTimer& timer, uint64_t expire_us, uint32_t period_us) {
+  cancel(timer);
+  timer.expire_us_ = expire_us;
+  timer.period_us_ = period_us;
+  insert(timer);
+}
+
+void TimerWheel::cancel(WheelTimer& timer) {
+  if (timer.active()) {
+    unlink(timer);
+  }
+}
+
+WheelTimer** TimerWheel::listHead(WheelTimer& timer) {
+  if (timer.level_ == WheelTimer::kPending) {
+    return &pending_;
+  } else {
+    return &slots_[timer.level_][timer.slot_];
+  }
+}
+
+void TimerWheel::insert(WheelTimer& timer) {
+  uint64_t expireTick = toTick(timer.expire_us_);
+  if (expireTick < currentTick_) {
+    expireTick = currentTick_;
+  }
+  uint64_t delta = expireTick - currentTick_;
+
+  uint8_t level = 0;
+  while (level < kLevels - 1 && delta >= ((uint64_t)1 << (kSlotBits * (level + 1)))) {
+    level++;
+  }
+  uint64_t maxDelta = ((uint64_t)1 << (kSlotBits * kLevels)) - 1;
+  if (delta > maxDelta) {  // beyond the wheel span, re-placed once its parking slot comes up
+    expireTick = currentTick_ + maxDelta;
+  }
+  uint8_t slot = (expireTick >> (kSlotBits * level)) & (kSlots - 1);
+
+  WheelTimer*& head = slots_[level][slot];
+  timer.level_ = level;
+  timer.slot_ = slot;
+  timer.prev_ = NULL;
+  timer.next_ = head;
+  if (head != NULL) {
+    head->prev_ = &timer;
+  }
+  head = &timer;
+  occupied_[level] |= (uint64_t)1 << slot;
+}
+
+void TimerWheel::unlink(WheelTimer& timer) {
+  WheelTimer** head = listHead(timer);
+  if (timer.prev_ != NULL) {
+    timer.prev_->next_ = timer.next_;
+  } else {
+    *head = timer.next_;
+  }
+  if (timer.next_ != NULL) {
+    timer.next_->prev_ = timer.prev_;
+  }
+  if (*head == NULL && timer.level_ >= 0) {
+    occupied_[timer.level_] &= ~((uint64_t)1 << timer.slot_);
+  }
+  timer.next_ = NULL;
+  timer.prev_ = NULL;
+  timer.level_ = WheelTimer::kInactive;
+}
+
+void TimerWheel::cascade(uint8_t level, uint8_t slot) {
+  WheelTimer* timer = slots_[level][slot];
+  slots_[level][slot] = NULL;
+  occupied_[level] &= ~((uint64_t)1 << slot);
+  while (timer != NULL) {
+    WheelTimer* next = timer->next_;
+    insert(*timer);
+    timer = next;
+  }
+}
+
+uint8_t TimerWheel::firstOccupied(uint8_t level, uint8_t start) const {
+  uint64_t occupied = occupied_[level];
+  if (occupied == 0) {
+    return kSlots;
+  }
+  uint64_t rotated = occupied >> start;
+  if (start != 0) {
+    rotated |= occupied << (kSlots - start);
+  }
+  return __builtin_ctzll(rotated);
+}
+
+uint64_t TimerWheel::nextEventTick() const {
+  uint64_t eventTick = UINT64_MAX;
+  uint8_t offset = firstOccupied(0, currentTick_ & (kSlots - 1));
+  if (offset < kSlots) {
+    eventTick = currentTick_ + offset;
+  }
+  for (uint8_t level=1; level<kLevels; level++) {
+    // the slot matching the current position holds the timers a full rotation away, so start
+    // searching after it; upper level timers are due at the start of their slot
+    uint64_t levelTick = (currentTick_ >> (kSlotBits * level)) + 1;
+    offset = firstOccupied(level, levelTick & (kSlots - 1));
+    if (offset < kSlots) {
+      uint64_t tick = (levelTick + offset) << (kSlotBits * level);
+      if (tick < eventTick) {
+        eventTick = tick;
+      }
+    }
+  }
+  return eventTick;
+}
+
+void TimerWheel::advance(uint64_t tick) {
+  currentTick_ = tick;
+  for (uint8_t level=kLevels-1; level>0; level--) {
+    uint64_t levelMask = ((uint64_t)1 << (kSlotBits * level)) - 1;
+    if ((tick & levelMask) == 0) {
+      cascade(level, (tick >> (kSlotBits * level)) & (kSlots - 1));
+    }
+  }
+}
+
+size_t TimerWheel::poll() {
+  uint64_t nowTick = timebase_.read_us() >> tickShift_;
+  size_t fired = 0;
+  while (true) {
+    uint64_t tick = nextEventTick();
+    if (tick > nowTick) {  // skipped slots are all empty
+      advance(nowTick + 1);
+      break;
+    }
+    if (tick != currentTick_) {
+      advance(tick);
+    }
+
+    // move the expiring slot aside before running callbacks, since they may insert timers
+    uint8_t slot = tick & (kSlots - 1);
+    pending_ = slots_[0][slot];
+    slots_[0][slot] = NULL;
+    occupied_[0] &= ~((uint64_t)1 << slot);
+    for (WheelTimer* timer = pending_; timer != NULL; timer = timer->next_) {
+      timer->level_ = WheelTimer::kPending;
+    }
+    advance(tick + 1);
+
+    while (pending_ != NULL) {
+      WheelTimer& timer = *pending_;
+      unlink(timer);
+      if (timer.period_us_ != 0) {
+        timer.expire_us_ += timer.period_us_;
+        insert(timer);
+      }
+      timer.callback_.call();
+      fired++;
+    }
+  }
+  return fired;
+}
+
+uint64_t TimerWheel::nextDeadline_us() const {
+  uint64_t deadline = UINT64_MAX;
+  uint8_t offset = firstOccupied(0, currentTick_ & (kSlots - 1));
+  if (offset < kSlots) {
+    for (const WheelTimer* timer = slots_[0][(currentTick_ + offset) & (kSlots - 1)];
+        timer != NULL; timer = timer->next_) {
+      if (timer->expire_us_ < deadline) {
+        deadline = timer->expire_us_;
+      }
+    }
+  }
+  for (uint8_t level=1; level<kLevels; level++) {
+    uint64_t levelTick = (currentTick_ >> (kSlotBits * level)) + 1;
+    offset = firstOccupied(level, levelTick & (kSlots - 1));
+    if (offset < kSlots) {
+      for (const WheelTimer* timer = slots_[level][(levelTick + offset) & (kSlots - 1)];
+          timer != NULL; timer = timer->next_) {
+        if (timer->expire_us_ < deadline) {
+          deadline = timer->expire_us_;
+        }
+      }
+    }
+  }
+  return deadline;
+}
@@ -0,0 +1,149 @@
+#ifndef _TIMER_WHEEL_H_
+#define _TIMER_WHEEL_H_
+
+#include "mbed.h"
+
+#include "LongTimer.h"
+
+class TimerWheel;
+
+/**
+ * A timer scheduled on a TimerWheel. Intrusive: the wheel links the timer objects themselves, so
+ * they must outlive their time on the wheel (or be cancelled first).
+ */
+class WheelTimer {
+public:
+  WheelTimer(Callback<void()> callback) :
+      callback_(callback), next_(NULL), prev_(NULL), level_(kInactive) {
+  }
+
+  /**
+   * Returns whether the timer is scheduled to fire.
+   */
+  bool active() const {
+    return level_ != kInactive;
+  }
+
+  /**
+   * Returns the LongTimer time, in us, the timer is scheduled to fire at.
+   */
+  uint64_t expire_us() const {
+    return expire_us_;
+  }
+
+protected:
+  friend class TimerWheel;
+
+  static const int8_t kInactive = -1;
+  static const int8_t kPending = -2;  // expired and about to fire
+
+  Callback<void()> callback_;
+
+  uint64_t expire_us_;
+  uint32_t period_us_;  // 0 for one-shot timers
+
+  WheelTimer* next_;
+  WheelTimer* prev_;
+  int8_t level_;  // wheel level of the timer's slot, or kInactive or kPending
+  uint8_t slot_;
+};
+
+/**
+ * Hierarchical timing wheel, giving constant-time timer start, cancel and expiry regardless of
+ * the number of timers, driven by LongTimer 64-bit microseconds.
+ *
+ * Time is quantized into ticks of (1 << tickShift) us. Each level has 64 slots, each slot
+ * spanning 64 times the slots of the level below; timers are placed in the lowest level that can
+ * hold their remaining time, and move down a level when its slot comes up. Timers further away
+ * than the top level are parked at the end of the top level and re-placed when reached.
+ * Occupancy bitmaps let poll() skip directly over empty slots.
+ *
+ * Timers never fire early, and fire within one tick (plus poll latency) of their expiration.
+ * Not thread-safe: start, cancel and poll must all be called from the same thread (callbacks run
+ * from poll and may start and cancel timers).
+ */
+class TimerWheel {
+public:
+  static const uint8_t kLevels = 4;
+  static const uint8_t kSlotBits = 6;
+  static const uint8_t kSlots = 1 << kSlotBits;
+
+  /**
+   * @param timebase running LongTimer, whose update() is handled elsewhere
+   * @param tickShift log2 of the tick length in us, the default gives ~1ms ticks and a wheel span
+   *     of ~4.7 hours
+   */
+  TimerWheel(LongTimer& timebase, uint8_t tickShift = 10);
+
+  /**
+   * Schedules a timer to fire delay_us from now, replacing any existing schedule.
+   *
+   * @param period_us re-fire period for periodic timers, counted from the previous expiration
+   *     so it does not drift, or 0 for a one-shot timer
+   */
+  void start(WheelTimer& timer, uint32_t delay_us, uint32_t period_us = 0);
+
+  /**
+   * Schedules a timer to fire at an absolute LongTimer time, replacing any existing schedule.
+   */
+  void startAt(WheelTimer& timer, uint64_t expire_us, uint32_t period_us = 0);
+
+  /**
+   * Stops a timer. No-op if it is not active.
+   */
+  void cancel(WheelTimer& timer);
+
+  /**
+   * Fires all expired timers, call this from the main loop.
+   *
+   * @returns the number of callbacks run
+   */
+  size_t poll();
+
+  /**
+   * Returns the LongTimer time, in us, of the earliest active timer expiration, or UINT64_MAX if
+   * no timer is active. The loop can sleep until then.
+   */
+  uint64_t nextDeadline_us() const;
+
+protected:
+  uint64_t toTick(uint64_t time_us) const {  // rounds up, so timers never fire early
+    return (time_us + (1 << tickShift_) - 1) >> tickShift_;
+  }
+
+  void insert(WheelTimer& timer);
+  void unlink(WheelTimer& timer);
+  WheelTimer** listHead(WheelTimer& timer);
+
+  /**
+   * Sets the current tick, moving down the upper level slots that start at it.
+   * Any slots skipped over must be empty.
+   */
+  void advance(uint64_t tick);
+
+  /**
+   * Moves all the timers of a level's slot down into the lower levels.
+   */
+  void cascade(uint8_t level, uint8_t slot);
+
+  /**
+   * Returns the first occupied slot of a level at or after start, in wheel order, as an offset
+   * from start, or kSlots if the level is empty.
+   */
+  uint8_t firstOccupied(uint8_t level, uint8_t start) const;
+
+  /**
+   * Returns the earliest tick at which a timer fires or moves levels.
+   */
+  uint64_t nextEventTick() const;
+
+  LongTimer& timebase_;
+  const uint8_t tickShift_;
+
+  uint64_t currentTick_;  // next tick to be processed, upper level slots starting at it are already moved down
+  WheelTimer* slots_[kLevels][kSlots];
+  uint64_t occupied_[kLevels];  // bitmap of non-empty slots per level
+  WheelTimer* pending_;  // expired timers of the tick being processed
+};
+
+#endif
@@ -0,0 +1,21 @@
+#include "Trace.h"
+
+#ifdef TRACE_ENABLED
+
+namespace calsol {
+namespace util {
+namespace trace {
+
+Record ring[TRACE_RING_SIZE];
+atomic<uint32_t> head(0);
+atomic<bool> enabled(false);
+LongTimer* timebase = NULL;
+
+void init(LongTimer& timebase) {
+  trace::timebase = &timebase;
+  enabled.store(true);
+}
+
+}}}
+
+#endif
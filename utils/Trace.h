@@ -0,0 +1,146 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <stdint.h>
+
+/**
+ * Event trace recorder: fixed-size 8-byte records written lock-free into a RAM ring from any
+ * context, for seeing which interrupt preempted what and when. Dump the ring with dump() and
+ * convert it with tools/trace_to_chrome.py to view it in Chrome tracing or Perfetto.
+ *
+ * Slots are reserved with an atomic increment, so records from interrupts that preempt another
+ * record in progress are ordered by reservation, but each carries its own timestamp.
+ *
+ * The TRACE_* macros compile to nothing unless TRACE_ENABLED is defined (project-wide).
+ */
+#ifndef TRACE_RING_SIZE
+  #define TRACE_RING_SIZE 256  // in records, must be a power of two
+#endif
+
+namespace calsol {
+namespace util {
+namespace trace {
+
+/**
+ * Event types, matching the Chrome trace event phases.
+ */
+enum Type {
+  kBegin = 'B',  // begin and end must nest within one context, like a call stack
+  kEnd = 'E',
+  kInstant = 'i',
+  kAsyncBegin = 'b',  // for spans that begin and end in different contexts, such as a DMA
+  kAsyncEnd = 'e',  // transfer started by a thread and completed by an interrupt
+};
+
+/**
+ * Event IDs used by the library instrumentation, applications should use IDs below these.
+ */
+enum LibraryId {
+  kIdCanRxIrq = 0xf0,  // arg: messages read
+  kIdCanTxIrq = 0xf1,
+  kIdDmaIrq = 0xf2,  // arg: channel
+  kIdSerialPut = 0xf3,  // arg: bytes queued
+  kIdSerialDma = 0xf4,  // arg: transfer length
+};
+
+struct Record {
+  uint32_t timestamp_us;  // LongTimer::read_short_us
+  uint8_t type;
+  uint8_t id;
+  uint16_t arg;
+};
+
+}}}
+
+#ifdef TRACE_ENABLED
+
+#include <atomic>
+#include <cstdio>
+
+#include "mbed.h"
+
+#include "LongTimer.h"
+#include "SerialRetry.h"
+
+namespace calsol {
+namespace util {
+namespace trace {
+
+extern Record ring[TRACE_RING_SIZE];
+extern atomic<uint32_t> head;  // total records reserved, the ring index is the low bits
+extern atomic<bool> enabled;
+extern LongTimer* timebase;
+
+/**
+ * Starts recording with the given timebase.
+ */
+void init(LongTimer& timebase);
+
+inline void record(uint8_t type, uint8_t id, uint16_t arg) {
+  if (!enabled.load(std::memory_order_relaxed)) {
+    return;
+  }
+  Record& entry = ring[head.fetch_add(1, std::memory_order_relaxed) & (TRACE_RING_SIZE - 1)];
+  entry.timestamp_us = timebase->read_short_us();
+  entry.type = type;
+  entry.id = id;
+  entry.arg = arg;
+}
+
+/**
+ * Pauses or resumes recording, without clearing the ring.
+ */
+inline void setEnabled(bool enable) {
+  enabled.store(enable && timebase != NULL);
+}
+
+/**
+ * Writes the ring contents, oldest first, as text: a header line with the record count, then one
+ * line of hex fields (timestamp type id arg) per record. Recording is paused meanwhile.
+ * Waits for space in the serial queue rather than dropping lines, which would break parsing by
+ * tools/trace_to_chrome.py, see putsRetry.
+ *
+ * @tparam S serial type with puts(const char*), such as DmaSerialBase
+ */
+template <typename S>
+void dump(S& serial) {
+  bool wasEnabled = enabled.exchange(false);
+  uint32_t end = head.load();
+  uint32_t count = end < TRACE_RING_SIZE ? end : TRACE_RING_SIZE;
+
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "trace %lu\r\n", (unsigned long)count);
+  putsRetry(serial, buffer);
+  for (uint32_t i=end-count; i!=end; i++) {
+    const Record& entry = ring[i & (TRACE_RING_SIZE - 1)];
+    snprintf(buffer, sizeof(buffer), "%08lx %02x %02x %04x\r\n",
+        (unsigned long)entry.timestamp_us, entry.type, entry.id, entry.arg);
+    putsRetry(serial, buffer);
+  }
+  putsRetry(serial, "end\r\n");
+
+  enabled.store(wasEnabled);
+}
+
+}}}
+
+#define TRACE_BEGIN(id, arg) calsol::util::trace::record(calsol::util::trace::kBegin, id, arg)
+#define TRACE_END(id, arg) calsol::util::trace::record(calsol::util::trace::kEnd, id, arg)
+#define TRACE_INSTANT(id, arg) calsol::util::trace::record(calsol::util::trace::kInstant, id, arg)
+#define TRACE_ASYNC_BEGIN(id, arg) calsol::util::trace::record(calsol::util::trace::kAsyncBegin, id, arg)
+#define TRACE_ASYNC_END(id, arg) calsol::util::trace::record(calsol::util::trace::kAsyncEnd, id, arg)
+// Code only needed to compute trace arguments, such as a counter local to a handler
+#define TRACE_ONLY(...) __VA_ARGS__
+
+#else
+
+#define TRACE_BEGIN(id, arg)
+#define TRACE_END(id, arg)
+#define TRACE_INSTANT(id, arg)
+#define TRACE_ASYNC_BEGIN(id, arg)
+#define TRACE_ASYNC_END(id, arg)
+#define TRACE_ONLY(...)
+
+#endif
+
+#endif
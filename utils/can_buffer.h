@@ -14,6 +14,7 @@
 #endif // __ZEPHYR_COMMON_NO_MBED__
 
 #include "circular_buffer.h"
+#include "Trace.h"
 
 /** CAN Message circular buffer template class + IRQ handler
  *
@@ -105,10 +106,14 @@ public:
    *  Stops when there are no more pending messages or the RX buffer is full
    */
   void handleRxIrq() {
+    TRACE_BEGIN(calsol::util::trace::kIdCanRxIrq, 0);
     CANMessage msg;
+    TRACE_ONLY(uint16_t count = 0;)
     while (can.read(msg, handle) && !rxFull()) {
       rxBuffer.write(msg);
+      TRACE_ONLY(count++;)
     }
+    TRACE_END(calsol::util::trace::kIdCanRxIrq, count);
   }
 
   /** CAN transmit IRQ handler
@@ -116,6 +121,7 @@ public:
    *  It will then send a new message until the buffer is empty.
    */
   void handleTxIrq() {
+    TRACE_INSTANT(calsol::util::trace::kIdCanTxIrq, txBuffer.empty() ? 0 : 1);
     if(!txBuffer.empty()) {
       can.write(txBuffer.read());
     } else {